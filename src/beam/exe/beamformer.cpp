@@ -1,51 +1,860 @@
+#include "beam/lib/MVDRBeamformer.h"
+#include "beam/lib/OfflineProcessor.h"
 #include "beam/lib/Pipeline.h"
+#include "beam/lib/SessionScheduler.h"
+#include "beam/lib/StagedPipeline.h"
+#include "beam/lib/SteeringVectors.h"
+#include "beam/lib/StreamProcessor.h"
+#include <algorithm>
+#include <climits>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
 #include <iostream>
+#include <new>
 
 std::string input_file;
 std::string output_file;
+std::string beams_file;
+bool self_test = false;
+bool staged = false;
+bool profile = false;
+int segments = 1;
+double warmup_seconds = OFFLINE_WARMUP_SECONDS;
+int frame_size = FRAME_SIZE;
+Beam::PipelineConfig pipeline_config;
+
+// largest error of a SIMD FFT kernel relative to the scalar code.
+// float rounding with FMA stays around 1e-7 for the frame sizes we use.
+const float FFT_KERNEL_TOLERANCE = 1e-5f;
+
+// largest element of inverse * covariance - identity of the MVDR noise covariance. the covariance of
+// 4 channels of white noise is well conditioned, the inverse kept by the rank-1 updates is about 1e-6 off.
+const float MVDR_TOLERANCE = 1e-4f;
+
+// allocation hook of the selftest: while a thread points t_allocations to a counter,
+// every operator new on that thread increments it. the array forms call these.
+thread_local long long* t_allocations = NULL;
+
+void* operator new(size_t size) {
+	if (t_allocations)
+		++*t_allocations;
+	void* p = malloc(size ? size : 1);
+	if (!p)
+		throw std::bad_alloc();
+	return p;
+}
+
+void operator delete(void* p) noexcept {
+	free(p);
+}
 
 void exit_with_help() {
-	std::cout << "Usage: beamformer input_file output_file\n";
+	std::cout << "Usage: beamformer [--frame-size n] [--beamformer fixed|delay-sum|gsc|adaptive] [--noise-suppressor msr|spectral|none]\n";
+	std::cout << "                  [--no-localization] [--pre-noise-suppression] [--dereverberation] [--calibration]\n";
+	std::cout << "                  [--beams all|b,b,... beams_file]\n";
+	std::cout << "                  [--profile [--perf-counters] | --staged | --segments m [--warmup s]] input_file output_file\n";
+	std::cout << "       (n is 2^k, 5 * 2^k or 15 * 2^k samples from " << MIN_FRAME_SIZE << " to " << MAX_FRAME_SIZE
+		<< ", default " << FRAME_SIZE << ".\n";
+	std::cout << "        160 and 320 are 10 ms and 20 ms frames at " << SAMPLE_RATE << " Hz.\n";
+	std::cout << "        the default pipeline is the fixed beamformer with localization and the msr noise suppressor.\n";
+	std::cout << "        --no-localization keeps the beam at 0 degrees, --calibration needs the localization.\n";
+	std::cout << "        --beams also writes the fixed beams b (0 to " << MAX_BEAMS - 1 << ") to beams_file, one channel per beam.\n";
+	std::cout << "        --profile prints the time every stage of the pipeline takes per frame.\n";
+	std::cout << "        --perf-counters adds cycles, instructions, cache and branch misses from perf_event_open.\n";
+	std::cout << "        --staged runs the " << PIPELINE_STAGES << " stages of the pipeline on their own threads.\n";
+	std::cout << "        --segments cuts the file into m segments processed on m threads, 0 is one per core.\n";
+	std::cout << "        each segment starts s seconds early to warm up, default " << OFFLINE_WARMUP_SECONDS << ")\n";
+	std::cout << "       beamformer --selftest\n";
+	std::cout << "       (checks the SIMD FFT kernels against the scalar code, the FFT and MCLT against a DFT\n";
+	std::cout << "        and that pipelines run independently and without allocating, also on the session scheduler,\n";
+	std::cout << "        in stages and streaming)\n";
 	exit(1);
 }
 
 void parse_command_line(int argc, char* argv[]) {
-	if (argc != 3)
+	if (argc == 2 && std::string(argv[1]) == "--selftest") {
+		self_test = true;
+		return;
+	}
+	int arg = 1;
+	while (arg < argc && std::string(argv[arg]).compare(0, 2, "--") == 0) {
+		std::string option = argv[arg];
+		if (option == "--frame-size" && arg + 1 < argc) {
+			frame_size = atoi(argv[arg + 1]);
+			if (!Beam::Pipeline::supported_frame_size(frame_size))
+				exit_with_help();
+			arg += 2;
+		}
+		else if (option == "--beamformer" && arg + 1 < argc) {
+			std::string type = argv[arg + 1];
+			if (type == "fixed")
+				pipeline_config.beamformer = Beam::BEAMFORMER_FIXED;
+			else if (type == "delay-sum")
+				pipeline_config.beamformer = Beam::BEAMFORMER_DELAY_SUM;
+			else if (type == "gsc")
+				pipeline_config.beamformer = Beam::BEAMFORMER_GSC;
+			else if (type == "adaptive")
+				pipeline_config.beamformer = Beam::BEAMFORMER_ADAPTIVE;
+			else
+				exit_with_help();
+			arg += 2;
+		}
+		else if (option == "--noise-suppressor" && arg + 1 < argc) {
+			std::string type = argv[arg + 1];
+			if (type == "msr")
+				pipeline_config.noise_suppressor = Beam::NOISE_SUPPRESSOR_MSR;
+			else if (type == "spectral")
+				pipeline_config.noise_suppressor = Beam::NOISE_SUPPRESSOR_SPECTRAL;
+			else if (type == "none")
+				pipeline_config.noise_suppressor = Beam::NOISE_SUPPRESSOR_NONE;
+			else
+				exit_with_help();
+			arg += 2;
+		}
+		else if (option == "--no-localization") {
+			pipeline_config.localization = false;
+			++arg;
+		}
+		else if (option == "--pre-noise-suppression") {
+			pipeline_config.pre_noise_suppression = true;
+			++arg;
+		}
+		else if (option == "--dereverberation") {
+			pipeline_config.dereverberation = true;
+			++arg;
+		}
+		else if (option == "--calibration") {
+			pipeline_config.calibration = true;
+			++arg;
+		}
+		else if (option == "--beams" && arg + 2 < argc) {
+			std::string beams = argv[arg + 1];
+			if (beams == "all")
+				pipeline_config.beams = ALL_BEAMS;
+			else {
+				for (const char* p = beams.c_str(); *p; ) {
+					char* end;
+					long beam = strtol(p, &end, 10);
+					if (end == p || beam < 0 || beam >= MAX_BEAMS || (*end && *end != ','))
+						exit_with_help();
+					pipeline_config.beams |= 1u << beam;
+					p = *end ? end + 1 : end;
+				}
+			}
+			beams_file = argv[arg + 2];
+			arg += 3;
+		}
+		else if (option == "--profile") {
+			profile = true;
+			pipeline_config.profile = true;
+			++arg;
+		}
+		else if (option == "--perf-counters") {
+			pipeline_config.perf_counters = true;
+			++arg;
+		}
+		else if (option == "--staged") {
+			staged = true;
+			++arg;
+		}
+		else if (option == "--segments" && arg + 1 < argc) {
+			segments = atoi(argv[arg + 1]);
+			if (segments < 0)
+				exit_with_help();
+			arg += 2;
+		}
+		else if (option == "--warmup" && arg + 1 < argc) {
+			warmup_seconds = atof(argv[arg + 1]);
+			if (warmup_seconds < 0)
+				exit_with_help();
+			arg += 2;
+		}
+		else
+			exit_with_help();
+	}
+	if (argc != arg + 2 || (staged && segments != 1) || (profile && (staged || segments != 1)) || (pipeline_config.perf_counters && !profile)
+		|| (pipeline_config.beams && (staged || segments != 1)))
 		exit_with_help();
-	input_file = argv[1];
-	output_file = argv[2];
+	input_file = argv[arg];
+	output_file = argv[arg + 1];
+	pipeline_config.frame_size = frame_size;
+}
+
+// largest error of the scalar FFT relative to a double precision DFT, scaled by the largest coefficient.
+float fft_error(int size) {
+	Beam::FFTPlan plan(size);
+	std::vector<float> input(size), output(size);
+	for (int i = 0; i < size; ++i)
+		input[i] = (float) rand() / RAND_MAX - 0.5f;
+	Beam::FFT::AecCcsFwdFFT(plan, &input[0], &output[0], true);
+	double error = 0, peak = 0;
+	for (int k = 0; k <= size / 2; ++k) {
+		double re = 0, im = 0;
+		for (int n = 0; n < size; ++n) {
+			double phase = 2 * PI * (double) ((long long) k * n % size) / size;
+			re += input[n] * cos(phase);
+			im -= input[n] * sin(phase);
+		}
+		error = std::max(error, fabs(re - output[k]));
+		if (k > 0 && k < size / 2)
+			error = std::max(error, fabs(im - output[size - k]));
+		peak = std::max(peak, sqrt(re * re + im * im));
+	}
+	return (float) (error / peak);
+}
+
+// largest error of the forward MCLT relative to the same mapping computed in double precision
+// from a direct DFT, scaled by the largest coefficient. size is the number of input samples.
+float mclt_error(int size) {
+	int bins = size / 2;
+	Beam::FFTPlan plan(size);
+	std::vector<float> input(size), output(size);
+	for (int i = 0; i < size; ++i)
+		input[i] = (float) rand() / RAND_MAX - 0.5f;
+	Beam::MCLT::AecCcsFwdMclt(plan, &input[0], &output[0]);
+	// modulated DFT V[m] = X[m] * exp(-i * (pi / 4 + m * pi * (bins + 1) / size)), m = 0 ... bins
+	std::vector<std::complex<double> > modulated(bins + 1);
+	for (int m = 0; m <= bins; ++m) {
+		std::complex<double> x = 0;
+		for (int n = 0; n < size; ++n)
+			x += (double) input[n] * std::polar(1.0, -2 * PI * (double) ((long long) m * n % size) / size);
+		modulated[m] = x * std::polar(1.0, -(PI / 4 + PI * (double) m * (bins + 1) / size));
+	}
+	// MCLT[k] = sqrt(1 / size) * (V[k + 1] + i * V[k])
+	double error = 0, peak = 0;
+	for (int k = 0; k < bins; ++k) {
+		std::complex<double> expected = sqrt(1.0 / size) * (modulated[k + 1] + std::complex<double>(0, 1) * modulated[k]);
+		error = std::max(error, std::abs(expected - std::complex<double>(output[2 * k], output[2 * k + 1])));
+		peak = std::max(peak, std::abs(expected));
+	}
+	return (float) (error / peak);
+}
+
+// largest error of the fixed beamformer relative to a double precision filter with its weights, scaled by the
+// largest output, over random inputs and sound source angles, for all the beams at once. the channel vectors,
+// the interleaved input and the beam of the angle among all the beams go through the same kernel,
+// so their outputs must be the same, otherwise the error is 1.
+float beamformer_error(int frame_size) {
+	Beam::Beamformer beamformer(frame_size);
+	std::vector<std::complex<float> > channels[MAX_MICROPHONES], output(frame_size), interleaved_output(frame_size);
+	std::vector<std::complex<float> > interleaved(frame_size * MAX_MICROPHONES), beams(MAX_BEAMS * frame_size);
+	int beam_list[MAX_BEAMS];
+	std::complex<float>* beam_outputs[MAX_BEAMS];
+	for (int beam = 0; beam < MAX_BEAMS; ++beam) {
+		beam_list[beam] = beam;
+		beam_outputs[beam] = &beams[beam * frame_size];
+	}
+	double error = 0.0, peak = 0.0;
+	for (int trial = 0; trial < 20; ++trial) {
+		for (int channel = 0; channel < MAX_MICROPHONES; ++channel) {
+			channels[channel].resize(frame_size);
+			for (int bin = 0; bin < frame_size; ++bin) {
+				channels[channel][bin] = std::complex<float>((float) rand() / RAND_MAX - 0.5f, (float) rand() / RAND_MAX - 0.5f);
+				interleaved[bin * MAX_MICROPHONES + channel] = channels[channel][bin];
+			}
+		}
+		float angle = (float) (((double) rand() / RAND_MAX - 0.5) * PI);
+		beamformer.compute(channels, output, angle, 1.f, 0.0);
+		beamformer.compute(&interleaved[0], &interleaved_output[0], angle, 1.f, 0.0);
+		beamformer.compute_beams(channels, beam_outputs, beam_list, MAX_BEAMS);
+		if (output != interleaved_output || !std::equal(output.begin(), output.end(), beam_outputs[beamformer.beam()]))
+			return 1.f;
+		for (int beam = 0; beam < MAX_BEAMS; ++beam) {
+			for (int bin = 0; bin < frame_size; ++bin) {
+				std::complex<double> expected(0.0, 0.0);
+				for (int channel = 0; channel < MAX_MICROPHONES; ++channel)
+					expected += std::complex<double>(beamformer.weight(beam, bin, channel)) * std::complex<double>(channels[channel][bin]);
+				// the beamformer leaves the bins outside of the kinect band at 0, whose weights are 0 as well.
+				error = std::max(error, std::abs(expected - std::complex<double>(beam_outputs[beam][bin])));
+				peak = std::max(peak, std::abs(expected));
+			}
+		}
+	}
+	return (float) (error / peak);
+}
+
+// largest error of the adaptive beamformer relative to ansi_bf_msr_process_quad_loop_fast on every bin,
+// of the outputs and of the weights over frames of random input, scaled by their largest values.
+// mu is raised so the weights move far from the fixed ones within the frames.
+float adaptive_error(int frame_size) {
+	const int frames = 20;
+	Beam::Beamformer beamformer(frame_size);
+	beamformer.set_adaptive(true);
+	beamformer.set_adaptation(ADAPTIVE_NU, 0.2f);
+	std::vector<std::complex<float> > channels[MAX_MICROPHONES], output(frame_size);
+	std::vector<std::complex<float> > weights(frame_size * MAX_MICROPHONES);
+	double output_error = 0.0, output_peak = 0.0, weight_error = 0.0, weight_peak = 0.0;
+	for (int frame = 0; frame < frames; ++frame) {
+		for (int channel = 0; channel < MAX_MICROPHONES; ++channel) {
+			channels[channel].resize(frame_size);
+			for (int bin = 0; bin < frame_size; ++bin)
+				channels[channel][bin] = std::complex<float>(0.01f * ((float) rand() / RAND_MAX - 0.5f), 0.01f * ((float) rand() / RAND_MAX - 0.5f));
+		}
+		beamformer.compute(channels, output, 0.f, 1.f, 0.0);
+		for (int bin = beamformer.first_bin(); bin < beamformer.last_bin(); ++bin) {
+			std::complex<float>* w = &weights[bin * MAX_MICROPHONES];
+			std::complex<float> m[MAX_MICROPHONES], d[MAX_MICROPHONES], expected(0.f, 0.f);
+			for (int channel = 0; channel < MAX_MICROPHONES; ++channel) {
+				if (frame == 0)
+					w[channel] = beamformer.weight(beamformer.beam(), bin, channel);
+				m[channel] = channels[channel][bin];
+				d[channel] = beamformer.constraint(bin, channel);
+				expected += w[channel] * m[channel];
+			}
+			output_error = std::max(output_error, (double) std::abs(expected - output[bin]));
+			output_peak = std::max(output_peak, (double) std::abs(expected));
+			beamformer.ansi_bf_msr_process_quad_loop_fast(&w[0], &w[1], &w[2], &w[3], m[0], m[1], m[2], m[3], d[0], d[1], d[2], d[3], ADAPTIVE_NU, 0.2f);
+			for (int channel = 0; channel < MAX_MICROPHONES; ++channel) {
+				weight_error = std::max(weight_error, (double) std::abs(w[channel] - beamformer.adapted_weight(bin, channel)));
+				weight_peak = std::max(weight_peak, (double) std::abs(w[channel]));
+			}
+		}
+	}
+	return (float) std::max(output_error / output_peak, weight_error / weight_peak);
+}
+
+// largest error of the cached steering vectors relative to the phasors of their quantized angle,
+// 1 if two beamformers of a frame size would not share the cache.
+float steering_error(int frame_size) {
+	const Beam::SteeringVectors& steering = Beam::SteeringVectors::get(frame_size);
+	if (&Beam::SteeringVectors::get(frame_size) != &steering)
+		return 1.f;
+	double error = 0.0;
+	for (int trial = 0; trial < 50; ++trial) {
+		float angle = (float) (((double) rand() / RAND_MAX - 0.5) * TWO_PI);
+		const std::complex<float>* vector = steering.vector(angle);
+		double quantized = Beam::SteeringVectors::quantize(angle) * TWO_PI / STEERING_ANGLES;
+		for (int bin = 0; bin < frame_size; ++bin)
+			for (int channel = 0; channel < MAX_MICROPHONES; ++channel) {
+				double delay = Beam::KinectConfig::kinect_descriptor.mic[channel].y * sin(quantized) / SOUND_SPEED;
+				double phase = -bin * PI * SAMPLE_RATE / frame_size * delay;
+				error = std::max(error, std::abs(std::complex<double>(cos(phase), sin(phase)) - std::complex<double>(vector[bin * MAX_MICROPHONES + channel])));
+			}
+	}
+	return (float) error;
+}
+
+// largest error of the inverse noise covariance of the MVDR beamformer, kept up to date by rank-1 updates,
+// as the largest element of inverse * covariance - identity over all bins, after noise frames mixed with
+// voice frames that leave both as they are.
+float mvdr_error() {
+	const int frames = 1000;
+	Beam::MVDRBeamformer beamformer;
+	std::vector<std::complex<float> > channels[MAX_MICROPHONES], output(FRAME_SIZE);
+	for (int channel = 0; channel < MAX_MICROPHONES; ++channel)
+		channels[channel].resize(FRAME_SIZE);
+	for (int frame = 0; frame < frames; ++frame) {
+		for (int channel = 0; channel < MAX_MICROPHONES; ++channel)
+			for (int bin = 0; bin < FRAME_SIZE; ++bin)
+				channels[channel][bin] = std::complex<float>((float) rand() / RAND_MAX - 0.5f, (float) rand() / RAND_MAX - 0.5f);
+		beamformer.compute(channels, output, 0.3f, 1.f, 0.0, frame % 4 == 3);
+	}
+	float error = 0.f;
+	for (int bin = 0; bin < FRAME_SIZE; ++bin) {
+		Beam::MVDRBeamformer::Matrix product = beamformer.inverse(bin) * beamformer.covariance(bin) - Beam::MVDRBeamformer::Matrix::Identity();
+		error = std::max(error, product.cwiseAbs().maxCoeff());
+	}
+	return error;
+}
+
+// largest difference between two pipelines fed with the same frames, one of them moved half way.
+// the pipelines own all of their state, so the difference must be 0.
+float pipeline_difference(const Beam::PipelineConfig& config) {
+	const int frames = 40;
+	const int frame_size = config.frame_size;
+	Beam::Pipeline first(config);
+	std::vector<Beam::Pipeline> second;
+	second.push_back(Beam::Pipeline(config));
+	std::vector<float> input(MAX_MICROPHONES * frame_size), copy, output(frame_size), other(frame_size);
+	float difference = 0.f;
+	for (int frame = 0; frame < frames; ++frame) {
+		for (size_t i = 0; i < input.size(); ++i)
+			input[i] = 0.1f * ((float) rand() / RAND_MAX - 0.5f);
+		copy = input;
+		first.process(&input[0], &output[0]);
+		if (frame == frames / 2)
+			second.push_back(std::move(second[0]));
+		second.back().process(&copy[0], &other[0]);
+		for (int i = 0; i < frame_size; ++i)
+			difference = std::max(difference, fabsf(output[i] - other[i]));
+	}
+	return difference;
+}
+
+// heap allocations of Pipeline::process, on a signal that switches between a talker and silence every second,
+// so the localization, the voice activity and the gain control all change state.
+// the pipeline allocates everything when it is constructed, so the count must be 0 from the first frame on.
+long long pipeline_allocations(const Beam::PipelineConfig& config) {
+	const int frames = 500;
+	const int frame_size = config.frame_size;
+	Beam::Pipeline pipeline(config);
+	std::vector<float> input(MAX_MICROPHONES * frame_size), output(frame_size), beams(MAX_BEAMS * frame_size);
+	float* beam_outputs[MAX_BEAMS];
+	for (int index = 0; index < MAX_BEAMS; ++index)
+		beam_outputs[index] = &beams[index * frame_size];
+	long long allocations = 0;
+	t_allocations = &allocations;
+	for (int frame = 0; frame < frames; ++frame) {
+		float level = (frame * frame_size / SAMPLE_RATE) % 2 ? 0.3f : 0.001f;
+		for (int channel = 0; channel < MAX_MICROPHONES; ++channel)
+			for (int i = 0; i < frame_size; ++i) {
+				double t = (double) (frame * frame_size + i - channel) / SAMPLE_RATE;
+				input[channel * frame_size + i] = level * (float) sin(2.0 * PI * 440.0 * t) + 0.001f * ((float) rand() / RAND_MAX - 0.5f);
+			}
+		pipeline.process(&input[0], &output[0], beam_outputs);
+	}
+	t_allocations = NULL;
+	return allocations;
+}
+
+// largest difference of the outputs of a pipeline with all the beams to pipelines without localization, so the
+// fixed beamformer stays at its first beam and the gain control does not change: the output must be that of
+// the same pipeline without beams, the first beam that of the fixed beamformer without noise suppression.
+// the beams come out of the same kernels, so the difference must be 0.
+float beams_difference(Beam::BeamformerType beamformer) {
+	const int frames = 40;
+	const int frame_size = 160;
+	Beam::PipelineConfig config;
+	config.frame_size = frame_size;
+	config.beamformer = beamformer;
+	config.localization = false;
+	Beam::Pipeline single(config);
+	config.beams = ALL_BEAMS;
+	Beam::Pipeline multi(config);
+	config.beamformer = Beam::BEAMFORMER_FIXED;
+	config.noise_suppressor = Beam::NOISE_SUPPRESSOR_NONE;
+	config.beams = 0;
+	Beam::Pipeline fixed(config);
+	const int first_beam = Beam::Beamformer(frame_size).beam();
+	std::vector<float> input(MAX_MICROPHONES * frame_size), copy, other_copy, output(frame_size), other(frame_size), beam(frame_size);
+	std::vector<float> beams(MAX_BEAMS * frame_size);
+	float* beam_outputs[MAX_BEAMS];
+	for (int index = 0; index < MAX_BEAMS; ++index)
+		beam_outputs[index] = &beams[index * frame_size];
+	if (multi.num_beams() != MAX_BEAMS)
+		return 1.f;
+	float difference = 0.f;
+	for (int frame = 0; frame < frames; ++frame) {
+		for (size_t i = 0; i < input.size(); ++i)
+			input[i] = 0.1f * ((float) rand() / RAND_MAX - 0.5f);
+		copy = input;
+		other_copy = input;
+		single.process(&input[0], &output[0]);
+		multi.process(&copy[0], &other[0], beam_outputs);
+		fixed.process(&other_copy[0], &beam[0]);
+		for (int i = 0; i < frame_size; ++i) {
+			difference = std::max(difference, fabsf(output[i] - other[i]));
+			difference = std::max(difference, fabsf(beam[i] - beam_outputs[first_beam][i]));
+		}
+	}
+	return difference;
+}
+
+// largest difference between a pipeline with profiling and one without, 1 if a stage was not timed once per frame
+// or its percentiles are out of order. the profiler only reads the clock, so the difference must be 0.
+float profile_difference() {
+	const int frames = 30;
+	const int frame_size = 160;
+	Beam::PipelineConfig config;
+	config.frame_size = frame_size;
+	Beam::Pipeline pipeline(config);
+	config.profile = true;
+	Beam::Pipeline profiled(config);
+	std::vector<float> input(MAX_MICROPHONES * frame_size), copy, output(frame_size), other(frame_size);
+	float difference = 0.f;
+	for (int frame = 0; frame < frames; ++frame) {
+		for (size_t i = 0; i < input.size(); ++i)
+			input[i] = 0.1f * ((float) rand() / RAND_MAX - 0.5f);
+		copy = input;
+		pipeline.process(&input[0], &output[0]);
+		profiled.process(&copy[0], &other[0]);
+		for (int i = 0; i < frame_size; ++i)
+			difference = std::max(difference, fabsf(output[i] - other[i]));
+	}
+	for (int stage = 0; stage < Beam::PROFILE_STAGES; ++stage) {
+		Beam::StageTimes times = profiled.profiler()->times((Beam::ProfileStage) stage);
+		if (times.count != frames || times.p50 > times.p99 || times.p99 > times.max)
+			return 1.f;
+	}
+	// the kernels run inside their stages, at most once per frame. the localization skips quiet frames.
+	for (int kernel = Beam::PROFILE_STAGES; kernel < Beam::PROFILE_ENTRIES; ++kernel) {
+		long long count = profiled.profiler()->times((Beam::ProfileStage) kernel).count;
+		if (count > frames || (kernel != Beam::PROFILE_SSL && count != frames))
+			return 1.f;
+	}
+	return difference;
+}
+
+// print the stage times of a pipeline and their share of the real-time budget of a frame.
+// the kernels are indented below the stages, they are part of the stage times.
+void print_profile(const Beam::StageProfiler& profiler, int frame_size) {
+	const double budget = (double) frame_size / SAMPLE_RATE;
+	std::vector<Beam::StageTimes> times(Beam::PROFILE_ENTRIES);
+	for (int stage = 0; stage < Beam::PROFILE_ENTRIES; ++stage)
+		times[stage] = profiler.times((Beam::ProfileStage) stage);
+	std::cout << "stage                frames    p50 us    p99 us    max us   mean us  p99 of budget\n";
+	double total = 0.0;
+	for (int stage = 0; stage < Beam::PROFILE_ENTRIES; ++stage) {
+		const char* indent = stage < Beam::PROFILE_STAGES ? "" : "  ";
+		if (stage < Beam::PROFILE_STAGES)
+			total += times[stage].mean;
+		else if (times[stage].count == 0)
+			continue;
+		printf("%s%-*s %8lld %9.1f %9.1f %9.1f %9.1f %13.1f%%\n", indent, 18 - (int) strlen(indent), Beam::StageProfiler::name((Beam::ProfileStage) stage),
+			times[stage].count, times[stage].p50 * 1e6, times[stage].p99 * 1e6, times[stage].max * 1e6, times[stage].mean * 1e6, times[stage].p99 / budget * 100.0);
+	}
+	printf("mean %.1f us per frame of %.1f us, real-time factor %.3f\n", total * 1e6, budget * 1e6, total / budget);
+	if (!profiler.counters_available()) {
+		if (pipeline_config.perf_counters)
+			std::cout << "perf counters: not available (no pmu or perf_event_paranoid)\n";
+		return;
+	}
+	// events per call. ipc well below 1 with many cache misses points to memory, high ipc to compute.
+	printf("\n%-18s", "stage");
+	for (int counter = 0; counter < Beam::PERF_COUNTERS; ++counter)
+		printf(" %14s", Beam::PerfCounters::name((Beam::PerfCounter) counter));
+	printf(" %6s\n", "ipc");
+	for (int stage = 0; stage < Beam::PROFILE_ENTRIES; ++stage) {
+		if (times[stage].count == 0)
+			continue;
+		const char* indent = stage < Beam::PROFILE_STAGES ? "" : "  ";
+		printf("%s%-*s", indent, 18 - (int) strlen(indent), Beam::StageProfiler::name((Beam::ProfileStage) stage));
+		for (int counter = 0; counter < Beam::PERF_COUNTERS; ++counter) {
+			if (profiler.counter_available((Beam::PerfCounter) counter))
+				printf(" %14.0f", times[stage].events[counter]);
+			else
+				printf(" %14s", "-");
+		}
+		double cycles = times[stage].events[Beam::PERF_CYCLES];
+		if (cycles > 0 && profiler.counter_available(Beam::PERF_INSTRUCTIONS))
+			printf(" %6.2f\n", times[stage].events[Beam::PERF_INSTRUCTIONS] / cycles);
+		else
+			printf(" %6s\n", "-");
+	}
+}
+
+// largest difference between streams run by the session scheduler and the same streams run one after the other.
+// the scheduler keeps the frames of every stream in order, so the difference must be 0.
+float scheduler_difference(int threads, int streams) {
+	const int frames = 30;
+	const int frame_size = 160;
+	Beam::PipelineConfig config;
+	config.frame_size = frame_size;
+	std::vector<std::vector<float> > inputs(streams), expected(streams), outputs(streams);
+	for (int stream = 0; stream < streams; ++stream) {
+		inputs[stream].resize(frames * MAX_MICROPHONES * frame_size);
+		for (size_t i = 0; i < inputs[stream].size(); ++i)
+			inputs[stream][i] = 0.1f * ((float) rand() / RAND_MAX - 0.5f);
+		Beam::Pipeline pipeline(config);
+		std::vector<float> input;
+		expected[stream].resize(frames * frame_size);
+		for (int frame = 0; frame < frames; ++frame) {
+			input.assign(inputs[stream].begin() + frame * MAX_MICROPHONES * frame_size, inputs[stream].begin() + (frame + 1) * MAX_MICROPHONES * frame_size);
+			pipeline.process(&input[0], &expected[stream][frame * frame_size]);
+		}
+	}
+	{
+		Beam::SessionScheduler scheduler(threads);
+		for (int stream = 0; stream < streams; ++stream) {
+			scheduler.add_stream(config, [&outputs](int id, const float* output) {
+				outputs[id].insert(outputs[id].end(), output, output + frame_size);
+			});
+		}
+		for (int frame = 0; frame < frames; ++frame)
+			for (int stream = 0; stream < streams; ++stream)
+				scheduler.submit(stream, &inputs[stream][frame * MAX_MICROPHONES * frame_size]);
+		scheduler.wait();
+	}
+	float difference = 0.f;
+	for (int stream = 0; stream < streams; ++stream) {
+		if (outputs[stream].size() != expected[stream].size())
+			return 1.f;
+		for (size_t i = 0; i < expected[stream].size(); ++i)
+			difference = std::max(difference, fabsf(outputs[stream][i] - expected[stream][i]));
+	}
+	return difference;
+}
+
+// largest difference between the staged pipeline and Pipeline::process, with the output of the staged pipeline
+// moved back by its latency. the input stays below the levels of the gain control, so the difference must be 0.
+float staged_difference(int latency) {
+	const int frames = 30;
+	const int frame_size = 160;
+	Beam::PipelineConfig config;
+	config.frame_size = frame_size;
+	Beam::Pipeline pipeline(config);
+	Beam::StagedPipeline staged(config, latency);
+	std::vector<float> input(MAX_MICROPHONES * frame_size), copy, output(frame_size), staged_output(frame_size);
+	std::vector<float> expected;
+	float difference = 0.f;
+	for (int frame = 0; frame < frames + latency; ++frame) {
+		for (size_t i = 0; i < input.size(); ++i)
+			input[i] = frame < frames ? 0.1f * ((float) rand() / RAND_MAX - 0.5f) : 0.f;
+		copy = input;
+		pipeline.process(&copy[0], &output[0]);
+		expected.insert(expected.end(), output.begin(), output.end());
+		staged.process(&input[0], &staged_output[0]);
+		if (frame < latency)
+			continue;
+		for (int i = 0; i < frame_size; ++i)
+			difference = std::max(difference, fabsf(staged_output[i] - expected[(frame - latency) * frame_size + i]));
+	}
+	return difference;
+}
+
+// largest difference between a stream processor fed with 16 bit pcm in chunks of random size and
+// Pipeline::process on the same frames. the conversion is the same, so the difference must be 0.
+float stream_difference(int channels) {
+	const int frames = 20;
+	const int frame_size = 160;
+	Beam::PipelineConfig config;
+	config.frame_size = frame_size;
+	std::vector<short> pcm(frames * frame_size * channels);
+	for (size_t i = 0; i < pcm.size(); ++i)
+		pcm[i] = (short) (rand() % 6000 - 3000);
+	Beam::Pipeline pipeline(config);
+	std::vector<float> input(MAX_MICROPHONES * frame_size), expected(frames * frame_size);
+	for (int frame = 0; frame < frames; ++frame) {
+		std::fill(input.begin(), input.end(), 0.f);
+		for (int channel = 0; channel < std::min(channels, MAX_MICROPHONES); ++channel)
+			for (int i = 0; i < frame_size; ++i)
+				input[channel * frame_size + i] = (float) pcm[(frame * frame_size + i) * channels + channel] * (1.f / SHRT_MAX);
+		pipeline.process(&input[0], &expected[frame * frame_size]);
+	}
+	Beam::StreamProcessor stream(config, channels, Beam::SAMPLE_FORMAT_S16);
+	std::vector<float> output(frames * frame_size);
+	int pushed = 0, pulled = 0;
+	while (pushed < frames * frame_size) {
+		int samples = std::min(rand() % 500 + 1, frames * frame_size - pushed);
+		stream.push(&pcm[pushed * channels], samples);
+		pushed += samples;
+		pulled += stream.pull(&output[pulled], rand() % 300);
+	}
+	pulled += stream.pull(&output[pulled], frames * frame_size - pulled);
+	if (pulled != frames * frame_size)
+		return 1.f;
+	float difference = 0.f;
+	for (int i = 0; i < frames * frame_size; ++i)
+		difference = std::max(difference, fabsf(output[i] - expected[i]));
+	return difference;
+}
+
+int run_self_test() {
+	const int sizes[] = { TWO_FRAME_SIZE, 256, 1024, 320, 640, 480, 960 };
+	int failures = 0;
+	for (int size : sizes) {
+		float error = fft_error(size);
+		bool ok = error <= FFT_KERNEL_TOLERANCE;
+		std::cout << "fft " << size << ": error " << error << " against dft" << (ok ? " ok\n" : " FAILED\n");
+		if (!ok)
+			++failures;
+		error = mclt_error(size);
+		ok = error <= FFT_KERNEL_TOLERANCE;
+		std::cout << "mclt " << size << ": error " << error << " against double precision" << (ok ? " ok\n" : " FAILED\n");
+		if (!ok)
+			++failures;
+	}
+	for (int frame_size : { FRAME_SIZE, 160 }) {
+		float error = beamformer_error(frame_size);
+		bool ok = error <= FFT_KERNEL_TOLERANCE;
+		std::cout << "beamformer " << frame_size << ": error " << error << " against double precision" << (ok ? " ok\n" : " FAILED\n");
+		if (!ok)
+			++failures;
+	}
+	for (int frame_size : { FRAME_SIZE, 160 }) {
+		float error = adaptive_error(frame_size);
+		bool ok = error <= FFT_KERNEL_TOLERANCE;
+		std::cout << "adaptive beamformer " << frame_size << ": error " << error << " against the quad loop" << (ok ? " ok\n" : " FAILED\n");
+		if (!ok)
+			++failures;
+	}
+	for (int frame_size : { FRAME_SIZE, 160 }) {
+		float error = steering_error(frame_size);
+		bool ok = error <= FFT_KERNEL_TOLERANCE;
+		std::cout << "steering vectors " << frame_size << ": error " << error << " against double precision" << (ok ? " ok\n" : " FAILED\n");
+		if (!ok)
+			++failures;
+	}
+	float error = mvdr_error();
+	bool ok = error <= MVDR_TOLERANCE;
+	std::cout << "mvdr: error " << error << " of the updated inverse" << (ok ? " ok\n" : " FAILED\n");
+	if (!ok)
+		++failures;
+	for (int frame_size : { FRAME_SIZE, 160 }) {
+		Beam::PipelineConfig config;
+		config.frame_size = frame_size;
+		float difference = pipeline_difference(config);
+		std::cout << "pipeline " << frame_size << ": difference " << difference << " between instances" << (difference == 0.f ? " ok\n" : " FAILED\n");
+		if (difference != 0.f)
+			++failures;
+	}
+	// every component on, and the beamformers and noise suppressors that are off by default.
+	const char* beamformers[] = { "fixed", "delay-sum", "gsc", "adaptive" };
+	const char* noise_suppressors[] = { "msr", "spectral", "none" };
+	for (int beamformer = Beam::BEAMFORMER_FIXED; beamformer <= Beam::BEAMFORMER_ADAPTIVE; ++beamformer) {
+		for (int noise_suppressor = Beam::NOISE_SUPPRESSOR_MSR; noise_suppressor <= Beam::NOISE_SUPPRESSOR_NONE; ++noise_suppressor) {
+			Beam::PipelineConfig config;
+			config.frame_size = 160;
+			config.beamformer = (Beam::BeamformerType) beamformer;
+			config.noise_suppressor = (Beam::NoiseSuppressorType) noise_suppressor;
+			config.localization = beamformer != Beam::BEAMFORMER_DELAY_SUM;
+			config.pre_noise_suppression = config.dereverberation = config.calibration = noise_suppressor == Beam::NOISE_SUPPRESSOR_SPECTRAL;
+			float difference = pipeline_difference(config);
+			std::cout << "pipeline " << beamformers[beamformer] << ", " << noise_suppressors[noise_suppressor] << (config.localization ? "" : ", no localization")
+				<< (config.calibration ? ", all stages" : "") << ": difference " << difference << " between instances" << (difference == 0.f ? " ok\n" : " FAILED\n");
+			if (difference != 0.f)
+				++failures;
+		}
+	}
+	for (int frame_size : { FRAME_SIZE, 160 }) {
+		for (int all_stages = 0; all_stages <= 1; ++all_stages) {
+			Beam::PipelineConfig config;
+			config.frame_size = frame_size;
+			if (all_stages) {
+				config.noise_suppressor = Beam::NOISE_SUPPRESSOR_SPECTRAL;
+				config.pre_noise_suppression = config.dereverberation = config.calibration = config.profile = true;
+				config.beams = ALL_BEAMS;
+			}
+			long long allocations = pipeline_allocations(config);
+			std::cout << "pipeline " << frame_size << (all_stages ? ", all stages" : "") << ": " << allocations << " allocations in process"
+				<< (allocations == 0 ? " ok\n" : " FAILED\n");
+			if (allocations != 0)
+				++failures;
+		}
+	}
+	for (int beamformer : { Beam::BEAMFORMER_DELAY_SUM, Beam::BEAMFORMER_GSC, Beam::BEAMFORMER_ADAPTIVE }) {
+		Beam::PipelineConfig config;
+		config.beamformer = (Beam::BeamformerType) beamformer;
+		long long allocations = pipeline_allocations(config);
+		std::cout << "pipeline " << beamformers[beamformer] << ": " << allocations << " allocations in process"
+			<< (allocations == 0 ? " ok\n" : " FAILED\n");
+		if (allocations != 0)
+			++failures;
+	}
+	for (int beamformer = Beam::BEAMFORMER_FIXED; beamformer <= Beam::BEAMFORMER_ADAPTIVE; ++beamformer) {
+		float difference = beams_difference((Beam::BeamformerType) beamformer);
+		std::cout << "pipeline " << beamformers[beamformer] << ", all beams: difference " << difference << " to single beams" << (difference == 0.f ? " ok\n" : " FAILED\n");
+		if (difference != 0.f)
+			++failures;
+	}
+	float difference = profile_difference();
+	std::cout << "profile: difference " << difference << " to no profiling" << (difference == 0.f ? " ok\n" : " FAILED\n");
+	if (difference != 0.f)
+		++failures;
+	difference = scheduler_difference(3, 8);
+	std::cout << "scheduler: difference " << difference << " to sequential streams" << (difference == 0.f ? " ok\n" : " FAILED\n");
+	if (difference != 0.f)
+		++failures;
+	for (int channels : { 2, MAX_MICROPHONES, 6 }) {
+		difference = stream_difference(channels);
+		std::cout << "stream, " << channels << " channels: difference " << difference << " to process" << (difference == 0.f ? " ok\n" : " FAILED\n");
+		if (difference != 0.f)
+			++failures;
+	}
+	for (int latency : { 0, PIPELINE_STAGES - 1, 6 }) {
+		difference = staged_difference(latency);
+		std::cout << "staged pipeline, latency " << latency << ": difference " << difference << " to process" << (difference == 0.f ? " ok\n" : " FAILED\n");
+		if (difference != 0.f)
+			++failures;
+	}
+	for (int k = Beam::FFT_KERNEL_SCALAR + 1; k < Beam::FFT_KERNEL_COUNT; ++k) {
+		Beam::FFTKernelType kernel = (Beam::FFTKernelType)k;
+		if (!Beam::FFTKernels::supported(kernel)) {
+			std::cout << Beam::FFTKernels::name(kernel) << ": not supported, skipped\n";
+			continue;
+		}
+		for (int size : sizes) {
+			float error = Beam::FFTKernels::max_error(kernel, size);
+			bool ok = error <= FFT_KERNEL_TOLERANCE;
+			std::cout << Beam::FFTKernels::name(kernel) << " fft " << size << ": error " << error << (ok ? " ok\n" : " FAILED\n");
+			if (!ok)
+				++failures;
+		}
+	}
+	std::cout << "tolerance " << FFT_KERNEL_TOLERANCE << ", selected kernel " << Beam::FFTKernels::name(Beam::FFTKernels::best()) << std::endl;
+	return failures == 0 ? 0 : 1;
 }
 
 int main(int argc, char* argv[]) {
 	parse_command_line(argc, argv);
+	if (self_test)
+		return run_self_test();
+	if (segments != 1) {
+		Beam::OfflineProcessor processor(pipeline_config, segments, (int) (warmup_seconds * SAMPLE_RATE / frame_size + 0.5));
+		processor.process_file(input_file, output_file);
+		std::cout << "conversion done..." << std::endl;
+		return 0;
+	}
 	Beam::WavReader reader(input_file);
 	int channels = reader.get_channels();
 	int bytes_per_sample = reader.get_bit_per_sample() / 8;
 	Beam::WavWriter writer(output_file, 16000, 1, 16);
-	int buf_size = FRAME_SIZE * channels * bytes_per_sample;
-	int output_buf_size = FRAME_SIZE * 2;
+	std::unique_ptr<Beam::WavWriter> beams_writer;
+	std::unique_ptr<Beam::Pipeline> pipeline;
+	std::unique_ptr<Beam::StagedPipeline> stages;
+	if (staged)
+		stages.reset(new Beam::StagedPipeline(pipeline_config));
+	else
+		pipeline = Beam::Pipeline::create(pipeline_config);
+	int num_beams = pipeline ? pipeline->num_beams() : 0;
+	if (num_beams > 0)
+		beams_writer.reset(new Beam::WavWriter(beams_file, 16000, (short) num_beams, 16));
+	// the staged pipeline returns silence for the first frames, which are dropped, and is flushed at the end.
+	int skip = stages ? stages->latency() : 0;
+	int buf_size = frame_size * channels * bytes_per_sample;
+	int output_buf_size = frame_size * 2;
 	char* buf = new char[buf_size];
 	char* output_buf = new char[output_buf_size];
 	short* output_ptr = (short*) output_buf;
-	float input[MAX_MICROPHONES][FRAME_SIZE] = { 0.f };
-	float output[FRAME_SIZE] = { 0.f };
+	std::vector<float> input(MAX_MICROPHONES * frame_size, 0.f);
+	std::vector<float> output(frame_size, 0.f);
+	std::vector<float> beams(num_beams * frame_size);
+	std::vector<short> beams_buf(num_beams * frame_size);
+	std::vector<float*> beam_outputs(num_beams);
+	for (int index = 0; index < num_beams; ++index)
+		beam_outputs[index] = &beams[index * frame_size];
+	int flush = skip;
 	while (true) {
 		int buf_filled = 0;
 		reader.read(buf, buf_size, &buf_filled);
-		if (buf_filled < buf_size)
-			break;
-		reader.convert_format(input, buf, buf_size);
+		if (buf_filled < buf_size) {
+			if (flush == 0)
+				break;
+			--flush;
+			std::fill(input.begin(), input.end(), 0.f);
+		}
+		else
+			reader.convert_format(&input[0], buf, buf_size);
 		// this is the key step in the beamformer.
-		// input are 4 channels. each channel contains 256 float numbers.
-		// output is 1 channel. it contains 256 float numbers.
-		Beam::Pipeline::instance()->process(input, output); 
-		for (int i = 0; i < FRAME_SIZE; ++i) {
+		// input are 4 channels. each channel contains frame_size float numbers.
+		// output is 1 channel. it contains frame_size float numbers.
+		if (stages)
+			stages->process(&input[0], &output[0]);
+		else if (num_beams > 0)
+			pipeline->process(&input[0], &output[0], &beam_outputs[0]);
+		else
+			pipeline->process(&input[0], &output[0]);
+		if (skip > 0) {
+			--skip;
+			continue;
+		}
+		for (int i = 0; i < frame_size; ++i) {
 			output_ptr[i] = (short) (output[i] * SHRT_MAX);
 		}
-		writer.write(output_buf, FRAME_SIZE * 2);
+		writer.write(output_buf, frame_size * 2);
+		if (num_beams > 0) {
+			for (int i = 0; i < frame_size; ++i)
+				for (int index = 0; index < num_beams; ++index)
+					beams_buf[i * num_beams + index] = (short) (beam_outputs[index][i] * SHRT_MAX);
+			beams_writer->write((char*) &beams_buf[0], num_beams * frame_size * 2);
+		}
 	}
 	delete[] buf;
 	delete[] output_buf;
 	std::cout << "conversion done..." << std::endl;
+	if (profile)
+		print_profile(*pipeline->profiler(), frame_size);
 	return 0;
 }
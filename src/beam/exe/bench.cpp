@@ -0,0 +1,361 @@
+#include "beam/lib/Beamformer.h"
+#include "beam/lib/DelaySumBeamformer.h"
+#include "beam/lib/DeReverb.h"
+#include "beam/lib/FFT.h"
+#include "beam/lib/FFTKernels.h"
+#include "beam/lib/GSCBeamformer.h"
+#include "beam/lib/KinectConfig.h"
+#include "beam/lib/MCLT.h"
+#include "beam/lib/MsrNS.h"
+#include "beam/lib/MsrVAD.h"
+#include "beam/lib/MVDRBeamformer.h"
+#include "beam/lib/NoiseSuppressor.h"
+#include "beam/lib/Pipeline.h"
+#include "beam/lib/SoundSourceLocalizer.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <string>
+
+// microbenchmarks of the components and the whole pipeline on a synthetic recording.
+// every benchmark runs once over all frames to warm up, then repeat times. the median of the repeats is reported
+// in ns per frame, where a frame is the work the pipeline does per frame, e.g. the forward transform of all channels.
+// the input is the same on every run and every machine, so the numbers of two builds can be compared.
+
+int frames = 500;
+int repeat = 5;
+std::string output_file;
+
+// angle of the synthetic talker, rad.
+const float TALKER_ANGLE = 0.5f;
+
+void exit_with_help() {
+	std::cout << "Usage: beam_bench [--frames n] [--repeat r] [--output file]\n";
+	std::cout << "       (runs every benchmark over n frames of " << FRAME_SIZE << " samples, default " << frames << ",\n";
+	std::cout << "        r times, default " << repeat << ", and writes the results as json to the file or stdout)\n";
+	exit(1);
+}
+
+void parse_command_line(int argc, char* argv[]) {
+	int arg = 1;
+	while (arg < argc) {
+		std::string option = argv[arg];
+		if (option == "--frames" && arg + 1 < argc) {
+			frames = atoi(argv[arg + 1]);
+			if (frames <= 0)
+				exit_with_help();
+			arg += 2;
+		}
+		else if (option == "--repeat" && arg + 1 < argc) {
+			repeat = atoi(argv[arg + 1]);
+			if (repeat <= 0)
+				exit_with_help();
+			arg += 2;
+		}
+		else if (option == "--output" && arg + 1 < argc) {
+			output_file = argv[arg + 1];
+			arg += 2;
+		}
+		else
+			exit_with_help();
+	}
+}
+
+// the recording: a talker at TALKER_ANGLE, one second of a harmonic voice and half a second of silence,
+// in uncorrelated noise 30 dB below the voice. the noise comes from a fixed linear congruential generator.
+struct Recording {
+	// frame after frame, MAX_MICROPHONES channels of FRAME_SIZE samples each, channel after channel.
+	std::vector<float> samples;
+	// MCLT of every frame and channel, as Pipeline::analyze computes them.
+	std::vector<std::vector<std::complex<float> > > spectra;
+	const float* frame(int index) const { return &samples[(size_t) index * MAX_MICROPHONES * FRAME_SIZE]; }
+	std::vector<std::complex<float> >* frame_spectra(int index) { return &spectra[(size_t) index * MAX_MICROPHONES]; }
+};
+
+void synthesize_recording(Recording& recording) {
+	recording.samples.assign((size_t) frames * MAX_MICROPHONES * FRAME_SIZE, 0.f);
+	unsigned int seed = 12345;
+	for (int channel = 0; channel < MAX_MICROPHONES; ++channel) {
+		double delay = Beam::KinectConfig::kinect_descriptor.mic[channel].y * sin(TALKER_ANGLE) / SOUND_SPEED;
+		for (int frame = 0; frame < frames; ++frame) {
+			float* samples = &recording.samples[((size_t) frame * MAX_MICROPHONES + channel) * FRAME_SIZE];
+			for (int i = 0; i < FRAME_SIZE; ++i) {
+				double t = (double) (frame * FRAME_SIZE + i) / SAMPLE_RATE - delay;
+				double voice = 0.0;
+				if (fmod(t, 1.5) < 1.0) {
+					double pitch = 150.0 + 20.0 * sin(TWO_PI * 0.7 * t);
+					for (int harmonic = 1; harmonic <= 10; ++harmonic)
+						voice += sin(TWO_PI * pitch * harmonic * t) / harmonic;
+					voice *= 0.5 + 0.5 * sin(TWO_PI * 3.0 * t);
+				}
+				seed = seed * 1664525u + 1013904223u;
+				double noise = ((double) (seed >> 8) / (1 << 24) - 0.5) * 0.003;
+				samples[i] = (float) (0.05 * voice + noise);
+			}
+		}
+	}
+	recording.spectra.assign((size_t) frames * MAX_MICROPHONES, std::vector<std::complex<float> >(FRAME_SIZE));
+	Beam::FFTPlan plan(TWO_FRAME_SIZE);
+	std::vector<float> input(TWO_FRAME_SIZE);
+	for (int channel = 0; channel < MAX_MICROPHONES; ++channel) {
+		std::fill(input.begin(), input.end(), 0.f);
+		for (int frame = 0; frame < frames; ++frame) {
+			std::copy(input.begin() + FRAME_SIZE, input.end(), input.begin());
+			const float* samples = recording.frame(frame) + channel * FRAME_SIZE;
+			std::copy(samples, samples + FRAME_SIZE, input.begin() + FRAME_SIZE);
+			Beam::MCLT::AecCcsFwdMclt(plan, &input[0], reinterpret_cast<float*>(&recording.frame_spectra(frame)[channel][0]), frame & 0x03);
+		}
+	}
+}
+
+struct BenchResult {
+	std::string name;
+	double ns_per_frame; // median of the repeats.
+	double min_ns_per_frame;
+};
+
+// run body on every frame, once to warm up and repeat times timed.
+BenchResult run_benchmark(const std::string& name, std::function<void(int)> body) {
+	for (int frame = 0; frame < frames; ++frame)
+		body(frame);
+	std::vector<double> times;
+	for (int r = 0; r < repeat; ++r) {
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		for (int frame = 0; frame < frames; ++frame)
+			body(frame);
+		std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+		times.push_back((double) std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count() / frames);
+	}
+	std::sort(times.begin(), times.end());
+	BenchResult result;
+	result.name = name;
+	result.ns_per_frame = times[times.size() / 2];
+	result.min_ns_per_frame = times[0];
+	std::cerr << name << ": " << result.ns_per_frame << " ns per frame" << std::endl;
+	return result;
+}
+
+std::vector<BenchResult> run_benchmarks(Recording& recording) {
+	std::vector<BenchResult> results;
+	// inputs that a component changes in place are copied first, the copy is part of the time.
+	std::vector<std::complex<float> > spectra[MAX_MICROPHONES];
+	for (int channel = 0; channel < MAX_MICROPHONES; ++channel)
+		spectra[channel].assign(FRAME_SIZE, std::complex<float>(0.f, 0.f));
+	std::vector<std::complex<float> > spectrum(FRAME_SIZE);
+	std::vector<float> frame_input(MAX_MICROPHONES * FRAME_SIZE), output(FRAME_SIZE);
+	std::vector<float> window(TWO_FRAME_SIZE * MAX_MICROPHONES), transform(TWO_FRAME_SIZE);
+	auto copy_spectra = [&](int frame) {
+		for (int channel = 0; channel < MAX_MICROPHONES; ++channel)
+			spectra[channel] = recording.frame_spectra(frame)[channel];
+	};
+	{
+		// forward fft of every channel.
+		Beam::FFTPlan plan(TWO_FRAME_SIZE);
+		results.push_back(run_benchmark("fft", [&](int frame) {
+			const float* samples = recording.frame(frame);
+			for (int channel = 0; channel < MAX_MICROPHONES; ++channel) {
+				std::copy(samples + channel * FRAME_SIZE, samples + (channel + 1) * FRAME_SIZE, window.begin() + FRAME_SIZE);
+				Beam::FFT::AecCcsFwdFFT(plan, &window[0], &transform[0], true);
+			}
+		}));
+	}
+	{
+		// forward MCLT of all channels at once, the analysis of the pipeline.
+		Beam::FFTPlan plan(TWO_FRAME_SIZE, MAX_MICROPHONES);
+		float* outputs[MAX_MICROPHONES];
+		for (int channel = 0; channel < MAX_MICROPHONES; ++channel)
+			outputs[channel] = reinterpret_cast<float*>(&spectra[channel][0]);
+		results.push_back(run_benchmark("mclt_fwd", [&](int frame) {
+			const float* samples = recording.frame(frame);
+			std::copy(window.begin() + FRAME_SIZE * MAX_MICROPHONES, window.end(), window.begin());
+			for (int channel = 0; channel < MAX_MICROPHONES; ++channel)
+				for (int i = 0; i < FRAME_SIZE; ++i)
+					window[(FRAME_SIZE + i) * MAX_MICROPHONES + channel] = samples[channel * FRAME_SIZE + i];
+			Beam::MCLT::AecCcsFwdMcltBatch(plan, &window[0], outputs, frame & 0x03);
+		}));
+	}
+	{
+		// inverse MCLT with overlap-add of one channel, the synthesis of the pipeline.
+		Beam::FFTPlan plan(TWO_FRAME_SIZE);
+		std::vector<float> overlap(FRAME_SIZE, 0.f);
+		results.push_back(run_benchmark("mclt_inv", [&](int frame) {
+			spectrum = recording.frame_spectra(frame)[0];
+			Beam::MCLT::AecCcsInvMcltOverlapAdd(plan, reinterpret_cast<float*>(&spectrum[0]), &overlap[0], &output[0], frame & 0x03);
+		}));
+	}
+	{
+		Beam::SoundSourceLocalizer ssl;
+		ssl.init(SAMPLE_RATE, FRAME_SIZE);
+		results.push_back(run_benchmark("ssl", [&](int frame) {
+			float angle, weight;
+			copy_spectra(frame);
+			ssl.process(spectra, recording.frame_spectra(frame), &angle, &weight);
+		}));
+	}
+	{
+		Beam::MsrVAD vad;
+		Beam::MsrNS ns;
+		results.push_back(run_benchmark("msr_vad_ns", [&](int frame) {
+			spectrum = recording.frame_spectra(frame)[0];
+			vad.process(&spectrum[0]);
+			ns.process(&spectrum[0], &vad, true);
+		}));
+	}
+	{
+		// noise suppression of every channel, as the pre noise suppression does it.
+		std::vector<Beam::NoiseSuppressor> suppressors(MAX_MICROPHONES);
+		for (int channel = 0; channel < MAX_MICROPHONES; ++channel)
+			suppressors[channel].init(SAMPLE_RATE, FRAME_SIZE, 1.f, 10.f);
+		results.push_back(run_benchmark("noise_suppressor", [&](int frame) {
+			copy_spectra(frame);
+			for (int channel = 0; channel < MAX_MICROPHONES; ++channel)
+				suppressors[channel].noise_compensation(spectra[channel]);
+		}));
+	}
+	{
+		Beam::Beamformer beamformer;
+		results.push_back(run_benchmark("beamformer", [&](int frame) {
+			beamformer.compute(recording.frame_spectra(frame), spectrum, TALKER_ANGLE, 1.f, (double) frame * FRAME_SIZE / SAMPLE_RATE);
+		}));
+	}
+	{
+		// the adaptive mode of the beamformer, against its fixed weights above and the per-bin quad loop below.
+		Beam::Beamformer beamformer;
+		beamformer.set_adaptive(true);
+		results.push_back(run_benchmark("adaptive_beamformer", [&](int frame) {
+			beamformer.compute(recording.frame_spectra(frame), spectrum, TALKER_ANGLE, 1.f, (double) frame * FRAME_SIZE / SAMPLE_RATE);
+		}));
+	}
+	{
+		Beam::Beamformer beamformer;
+		std::vector<std::complex<float> > weights(FRAME_SIZE * MAX_MICROPHONES), constraint(FRAME_SIZE * MAX_MICROPHONES);
+		for (int bin = 0; bin < FRAME_SIZE; ++bin)
+			for (int channel = 0; channel < MAX_MICROPHONES; ++channel) {
+				weights[bin * MAX_MICROPHONES + channel] = beamformer.weight(beamformer.beam(), bin, channel);
+				constraint[bin * MAX_MICROPHONES + channel] = Beam::KinectConfig::kinect_dd[beamformer.beam()][bin][channel];
+			}
+		results.push_back(run_benchmark("adaptive_quad_loop", [&](int frame) {
+			std::vector<std::complex<float> >* input = recording.frame_spectra(frame);
+			for (int bin = beamformer.first_bin(); bin < beamformer.last_bin(); ++bin) {
+				std::complex<float>* w = &weights[bin * MAX_MICROPHONES];
+				std::complex<float>* d = &constraint[bin * MAX_MICROPHONES];
+				spectrum[bin] = w[0] * input[0][bin] + w[1] * input[1][bin] + w[2] * input[2][bin] + w[3] * input[3][bin];
+				beamformer.ansi_bf_msr_process_quad_loop_fast(&w[0], &w[1], &w[2], &w[3], input[0][bin], input[1][bin], input[2][bin], input[3][bin],
+					d[0], d[1], d[2], d[3], ADAPTIVE_NU, ADAPTIVE_MU);
+			}
+		}));
+	}
+	{
+		// every fixed beam in one pass.
+		Beam::Beamformer beamformer;
+		std::vector<std::complex<float> > beams(MAX_BEAMS * FRAME_SIZE);
+		int beam_list[MAX_BEAMS];
+		std::complex<float>* beam_outputs[MAX_BEAMS];
+		for (int beam = 0; beam < MAX_BEAMS; ++beam) {
+			beam_list[beam] = beam;
+			beam_outputs[beam] = &beams[beam * FRAME_SIZE];
+		}
+		results.push_back(run_benchmark("all_beams", [&](int frame) {
+			beamformer.compute_beams(recording.frame_spectra(frame), beam_outputs, beam_list, MAX_BEAMS);
+		}));
+	}
+	{
+		Beam::DelaySumBeamformer beamformer;
+		results.push_back(run_benchmark("delay_sum", [&](int frame) {
+			beamformer.compute(recording.frame_spectra(frame), spectrum, TALKER_ANGLE, 1.f, (double) frame * FRAME_SIZE / SAMPLE_RATE);
+		}));
+	}
+	{
+		Beam::GSCBeamformer beamformer;
+		results.push_back(run_benchmark("gsc", [&](int frame) {
+			std::copy(recording.frame(frame), recording.frame(frame) + MAX_MICROPHONES * FRAME_SIZE, frame_input.begin());
+			beamformer.compute(&output[0], &frame_input[0], TALKER_ANGLE, fmod((double) frame * FRAME_SIZE / SAMPLE_RATE, 1.5) < 1.0);
+		}));
+	}
+	{
+		// talker for 1 s, then 0.5 s of noise that updates the noise covariance.
+		Beam::MVDRBeamformer beamformer;
+		results.push_back(run_benchmark("mvdr", [&](int frame) {
+			double time = (double) frame * FRAME_SIZE / SAMPLE_RATE;
+			beamformer.compute(recording.frame_spectra(frame), spectrum, TALKER_ANGLE, 1.f, time, fmod(time, 1.5) < 1.0);
+		}));
+	}
+	{
+		std::vector<Beam::DeReverb> dereverb(MAX_MICROPHONES);
+		results.push_back(run_benchmark("dereverb", [&](int frame) {
+			copy_spectra(frame);
+			for (int channel = 0; channel < MAX_MICROPHONES; ++channel)
+				dereverb[channel].suppress(spectra[channel]);
+		}));
+	}
+	{
+		// the default pipeline, from the time domain input to the time domain output.
+		Beam::Pipeline pipeline;
+		results.push_back(run_benchmark("pipeline", [&](int frame) {
+			std::copy(recording.frame(frame), recording.frame(frame) + MAX_MICROPHONES * FRAME_SIZE, frame_input.begin());
+			pipeline.process(&frame_input[0], &output[0]);
+		}));
+	}
+	{
+		// the default pipeline with the time domain output of every fixed beam as well.
+		Beam::PipelineConfig config;
+		config.beams = ALL_BEAMS;
+		Beam::Pipeline pipeline(config);
+		std::vector<float> beams(MAX_BEAMS * FRAME_SIZE);
+		float* beam_outputs[MAX_BEAMS];
+		for (int beam = 0; beam < MAX_BEAMS; ++beam)
+			beam_outputs[beam] = &beams[beam * FRAME_SIZE];
+		results.push_back(run_benchmark("pipeline_all_beams", [&](int frame) {
+			std::copy(recording.frame(frame), recording.frame(frame) + MAX_MICROPHONES * FRAME_SIZE, frame_input.begin());
+			pipeline.process(&frame_input[0], &output[0], beam_outputs);
+		}));
+	}
+	return results;
+}
+
+void write_json(std::ostream& out, const std::vector<BenchResult>& results) {
+	const double frame_ns = 1e9 * FRAME_SIZE / SAMPLE_RATE;
+#ifdef __OPTIMIZE__
+	const bool optimized = true;
+#else
+	const bool optimized = false;
+#endif
+	out << "{\n";
+	out << "  \"frame_size\": " << FRAME_SIZE << ",\n";
+	out << "  \"sample_rate\": " << SAMPLE_RATE << ",\n";
+	out << "  \"frame_ns\": " << (long long) frame_ns << ",\n";
+	out << "  \"frames\": " << frames << ",\n";
+	out << "  \"repeat\": " << repeat << ",\n";
+	out << "  \"optimized\": " << (optimized ? "true" : "false") << ",\n";
+	out << "  \"fft_kernel\": \"" << Beam::FFTKernels::name(Beam::FFTKernels::best()) << "\",\n";
+	out << "  \"benchmarks\": [\n";
+	for (size_t i = 0; i < results.size(); ++i) {
+		char line[256];
+		snprintf(line, sizeof(line), "    {\"name\": \"%s\", \"ns_per_frame\": %.0f, \"min_ns_per_frame\": %.0f, \"real_time_factor\": %.6f}%s\n",
+			results[i].name.c_str(), results[i].ns_per_frame, results[i].min_ns_per_frame, results[i].ns_per_frame / frame_ns,
+			i + 1 < results.size() ? "," : "");
+		out << line;
+	}
+	out << "  ]\n";
+	out << "}\n";
+}
+
+int main(int argc, char* argv[]) {
+	parse_command_line(argc, argv);
+	Recording recording;
+	synthesize_recording(recording);
+	std::vector<BenchResult> results = run_benchmarks(recording);
+	if (output_file.empty()) {
+		write_json(std::cout, results);
+	}
+	else {
+		std::ofstream out(output_file.c_str());
+		write_json(out, results);
+	}
+	return 0;
+}
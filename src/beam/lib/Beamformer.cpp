@@ -1,19 +1,194 @@
 #include "Beamformer.h"
+#include "FFTKernels.h"
+#include <algorithm>
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#define BEAM_X86_SIMD
+#include <immintrin.h>
+#endif
+
+// gcc and clang only emit the instructions of a function's target, msvc always can.
+#if defined(__GNUC__) || defined(__clang__)
+#define BEAM_TARGET(isa) __attribute__((target(isa)))
+#else
+#define BEAM_TARGET(isa)
+#endif
 
 namespace Beam{
-	Beamformer::Beamformer() : m_beam(5){
-		// initialize the first and last bin
-		m_first_bin = (int)(KinectConfig::kinect_descriptor.freq_low / (float)SAMPLE_RATE * (float)FRAME_SIZE * 2.f);
-		m_last_bin = (int)(KinectConfig::kinect_descriptor.freq_high / (float)SAMPLE_RATE * (float)FRAME_SIZE * 2.f);
+	// outputs[row][bin] = sum over the channels of the weights of beam beams[row] times input[bin][channel],
+	// for first <= bin < last. the weights of beam b start at weights + b * stride.
+	static void filter_scalar(const std::complex<float>* weights, size_t stride, const int* beams, int num_beams, const std::complex<float>* input, std::complex<float>* const* outputs, int first, int last){
+		for (int bin = first; bin < last; ++bin){
+			const std::complex<float>* x = input + bin * MAX_MICROPHONES;
+			for (int row = 0; row < num_beams; ++row){
+				const std::complex<float>* w = weights + beams[row] * stride + bin * MAX_MICROPHONES;
+				std::complex<float> sum(0.f, 0.f);
+				for (int channel = 0; channel < MAX_MICROPHONES; ++channel){
+					sum += w[channel] * x[channel];
+				}
+				outputs[row][bin] = sum;
+			}
+		}
+	}
 
-		for (int beam = 0; beam < MAX_BEAMS; ++beam){
+#ifdef BEAM_X86_SIMD
+	// the 4 channels of a bin are one register of 4 complex numbers. the complex products come from an fmaddsub
+	// of the real and the imaginary parts of the weights, then the registers of 4 bins are reduced to their 4 sums
+	// by adding their channel pairs, which leaves the sums of bins in order.
+	BEAM_TARGET("avx2,fma") static inline __m256 complex_multiply_avx2(__m256 w, __m256 x){
+		__m256 x_swapped = _mm256_permute_ps(x, 0xb1); // (im, re)
+		return _mm256_fmaddsub_ps(_mm256_moveldup_ps(w), x, _mm256_mul_ps(_mm256_movehdup_ps(w), x_swapped));
+	}
+
+	// the sums of 4 bins from their weights w and their inputs x0 ... x3.
+	BEAM_TARGET("avx2,fma") static inline __m256 filter_bins_avx2(const float* w, __m256 x0, __m256 x1, __m256 x2, __m256 x3){
+		__m256d p0 = _mm256_castps_pd(complex_multiply_avx2(_mm256_loadu_ps(w), x0));
+		__m256d p1 = _mm256_castps_pd(complex_multiply_avx2(_mm256_loadu_ps(w + 8), x1));
+		__m256d p2 = _mm256_castps_pd(complex_multiply_avx2(_mm256_loadu_ps(w + 16), x2));
+		__m256d p3 = _mm256_castps_pd(complex_multiply_avx2(_mm256_loadu_ps(w + 24), x3));
+		// (p0 c0 + c1, p1 c0 + c1 | p0 c2 + c3, p1 c2 + c3), the same for p2 and p3.
+		__m256 s01 = _mm256_add_ps(_mm256_castpd_ps(_mm256_unpacklo_pd(p0, p1)), _mm256_castpd_ps(_mm256_unpackhi_pd(p0, p1)));
+		__m256 s23 = _mm256_add_ps(_mm256_castpd_ps(_mm256_unpacklo_pd(p2, p3)), _mm256_castpd_ps(_mm256_unpackhi_pd(p2, p3)));
+		return _mm256_add_ps(_mm256_permute2f128_ps(s01, s23, 0x20), _mm256_permute2f128_ps(s01, s23, 0x31));
+	}
+
+	// the input of 4 bins stays in registers while it is multiplied with the weights of every beam.
+	BEAM_TARGET("avx2,fma") static void filter_avx2(const std::complex<float>* weights, size_t stride, const int* beams, int num_beams, const std::complex<float>* input, std::complex<float>* const* outputs, int first, int last){
+		const float* x = reinterpret_cast<const float*>(input);
+		int bin = first;
+		for (; bin + 4 <= last; bin += 4){
+			const int offset = bin * MAX_MICROPHONES * 2;
+			__m256 x0 = _mm256_loadu_ps(x + offset);
+			__m256 x1 = _mm256_loadu_ps(x + offset + 8);
+			__m256 x2 = _mm256_loadu_ps(x + offset + 16);
+			__m256 x3 = _mm256_loadu_ps(x + offset + 24);
+			for (int row = 0; row < num_beams; ++row){
+				const float* w = reinterpret_cast<const float*>(weights + beams[row] * stride) + offset;
+				_mm256_storeu_ps(reinterpret_cast<float*>(outputs[row]) + bin * 2, filter_bins_avx2(w, x0, x1, x2, x3));
+			}
+		}
+		filter_scalar(weights, stride, beams, num_beams, input, outputs, bin, last);
+	}
+#endif
+
+	static void filter(const std::complex<float>* weights, size_t stride, const int* beams, int num_beams, const std::complex<float>* input, std::complex<float>* const* outputs, int first, int last){
+#ifdef BEAM_X86_SIMD
+		static const bool avx2 = MAX_MICROPHONES == 4 && FFTKernels::supported(FFT_KERNEL_AVX2);
+		if (avx2){
+			filter_avx2(weights, stride, beams, num_beams, input, outputs, first, last);
+			return;
+		}
+#endif
+		filter_scalar(weights, stride, beams, num_beams, input, outputs, first, last);
+	}
+
+	// adaptive mode on structure of arrays: row r of w, d and x starts at w + r * stride, the real parts of the
+	// channels are rows 0 ... MAX_MICROPHONES - 1, the imaginary parts the rows after them.
+	// output[bin] is the sum over the channels of w * x, then w moves towards the MVDR weights of the bin
+	// for the covariance nu + x x^H and the steering vector d, which are conj(u) / den with
+	// g = nu + |x|^2, s = x^H d, u = g * d - x * s and den = g * |d|^2 - |s|^2,
+	// the closed form of ansi_bf_msr_process_quad_loop_fast: w = (1 - mu) * w + mu * conj(u) / den.
+	static void adapt_scalar(float* w, const float* d, const float* x, const float* nu, const float* mu, std::complex<float>* output, size_t stride, int first, int last){
+		const size_t im = MAX_MICROPHONES * stride;
+		for (int bin = first; bin < last; ++bin){
+			float yr = 0.f, yi = 0.f, power = 0.f, d_power = 0.f, sr = 0.f, si = 0.f;
+			for (int channel = 0; channel < MAX_MICROPHONES; ++channel){
+				const size_t re = channel * stride + bin;
+				yr += w[re] * x[re] - w[re + im] * x[re + im];
+				yi += w[re] * x[re + im] + w[re + im] * x[re];
+				power += x[re] * x[re] + x[re + im] * x[re + im];
+				d_power += d[re] * d[re] + d[re + im] * d[re + im];
+				sr += x[re] * d[re] + x[re + im] * d[re + im];
+				si += x[re] * d[re + im] - x[re + im] * d[re];
+			}
+			output[bin] = std::complex<float>(yr, yi);
+			const float g = nu[bin] + power;
+			const float step = mu[bin] / (g * d_power - (sr * sr + si * si));
+			const float keep = 1.f - mu[bin];
+			for (int channel = 0; channel < MAX_MICROPHONES; ++channel){
+				const size_t re = channel * stride + bin;
+				float ur = g * d[re] - (x[re] * sr - x[re + im] * si);
+				float ui = g * d[re + im] - (x[re] * si + x[re + im] * sr);
+				w[re] = keep * w[re] + step * ur;
+				w[re + im] = keep * w[re + im] - step * ui;
+			}
+		}
+	}
+
+#ifdef BEAM_X86_SIMD
+	// adapt_scalar on 8 bins per instruction.
+	BEAM_TARGET("avx2,fma") static void adapt_avx2(float* w, const float* d, const float* x, const float* nu, const float* mu, std::complex<float>* output, size_t stride, int first, int last){
+		const size_t im = MAX_MICROPHONES * stride;
+		float* y = reinterpret_cast<float*>(output);
+		int bin = first;
+		for (; bin + 8 <= last; bin += 8){
+			__m256 xr[MAX_MICROPHONES], xi[MAX_MICROPHONES], dr[MAX_MICROPHONES], di[MAX_MICROPHONES];
+			__m256 yr = _mm256_setzero_ps(), yi = _mm256_setzero_ps(), power = _mm256_setzero_ps();
+			__m256 d_power = _mm256_setzero_ps(), sr = _mm256_setzero_ps(), si = _mm256_setzero_ps();
+			for (int channel = 0; channel < MAX_MICROPHONES; ++channel){
+				const size_t re = channel * stride + bin;
+				__m256 wr = _mm256_loadu_ps(w + re);
+				__m256 wi = _mm256_loadu_ps(w + re + im);
+				xr[channel] = _mm256_loadu_ps(x + re);
+				xi[channel] = _mm256_loadu_ps(x + re + im);
+				dr[channel] = _mm256_loadu_ps(d + re);
+				di[channel] = _mm256_loadu_ps(d + re + im);
+				yr = _mm256_fnmadd_ps(wi, xi[channel], _mm256_fmadd_ps(wr, xr[channel], yr));
+				yi = _mm256_fmadd_ps(wi, xr[channel], _mm256_fmadd_ps(wr, xi[channel], yi));
+				power = _mm256_fmadd_ps(xi[channel], xi[channel], _mm256_fmadd_ps(xr[channel], xr[channel], power));
+				d_power = _mm256_fmadd_ps(di[channel], di[channel], _mm256_fmadd_ps(dr[channel], dr[channel], d_power));
+				sr = _mm256_fmadd_ps(xi[channel], di[channel], _mm256_fmadd_ps(xr[channel], dr[channel], sr));
+				si = _mm256_fnmadd_ps(xi[channel], dr[channel], _mm256_fmadd_ps(xr[channel], di[channel], si));
+			}
+			// (re, im) of the 8 bins: unpack gives bins 0 1 4 5 and 2 3 6 7, the lane permutes put them in order.
+			__m256 lo = _mm256_unpacklo_ps(yr, yi);
+			__m256 hi = _mm256_unpackhi_ps(yr, yi);
+			_mm256_storeu_ps(y + bin * 2, _mm256_permute2f128_ps(lo, hi, 0x20));
+			_mm256_storeu_ps(y + bin * 2 + 8, _mm256_permute2f128_ps(lo, hi, 0x31));
+			const __m256 step_size = _mm256_loadu_ps(mu + bin);
+			const __m256 g = _mm256_add_ps(_mm256_loadu_ps(nu + bin), power);
+			const __m256 step = _mm256_div_ps(step_size, _mm256_fmsub_ps(g, d_power, _mm256_fmadd_ps(sr, sr, _mm256_mul_ps(si, si))));
+			const __m256 keep = _mm256_sub_ps(_mm256_set1_ps(1.f), step_size);
 			for (int channel = 0; channel < MAX_MICROPHONES; ++channel){
-				m_pcm_weights[beam][channel].assign(FRAME_SIZE, std::complex<float>(0.f, 0.f));
+				const size_t re = channel * stride + bin;
+				__m256 ur = _mm256_fmsub_ps(g, dr[channel], _mm256_fmsub_ps(xr[channel], sr, _mm256_mul_ps(xi[channel], si)));
+				__m256 ui = _mm256_fmsub_ps(g, di[channel], _mm256_fmadd_ps(xr[channel], si, _mm256_mul_ps(xi[channel], sr)));
+				_mm256_storeu_ps(w + re, _mm256_fmadd_ps(keep, _mm256_loadu_ps(w + re), _mm256_mul_ps(step, ur)));
+				_mm256_storeu_ps(w + re + im, _mm256_fmsub_ps(keep, _mm256_loadu_ps(w + re + im), _mm256_mul_ps(step, ui)));
 			}
 		}
+		adapt_scalar(w, d, x, nu, mu, output, stride, bin, last);
+	}
+#endif
+
+	static void adapt(float* w, const float* d, const float* x, const float* nu, const float* mu, std::complex<float>* output, size_t stride, int first, int last){
+#ifdef BEAM_X86_SIMD
+		static const bool avx2 = FFTKernels::supported(FFT_KERNEL_AVX2);
+		if (avx2){
+			adapt_avx2(w, d, x, nu, mu, output, stride, first, last);
+			return;
+		}
+#endif
+		adapt_scalar(w, d, x, nu, mu, output, stride, first, last);
+	}
+
+	Beamformer::Beamformer(int frame_size) : m_frame_size(frame_size), m_beam(5), m_adaptive(false), m_adapted_beam(-1){
+		// initialize the first and last bin
+		m_first_bin = (int)(KinectConfig::kinect_descriptor.freq_low / (float)SAMPLE_RATE * (float)frame_size * 2.f);
+		m_last_bin = (int)(KinectConfig::kinect_descriptor.freq_high / (float)SAMPLE_RATE * (float)frame_size * 2.f);
+
+		m_weights.assign((size_t)MAX_BEAMS * frame_size * MAX_MICROPHONES, std::complex<float>(0.f, 0.f));
+		m_input.assign((size_t)frame_size * MAX_MICROPHONES, std::complex<float>(0.f, 0.f));
+		// the rows of the adaptive state start on cache lines.
+		m_stride = ((size_t)frame_size + SIMD_ALIGNMENT / sizeof(float) - 1) / (SIMD_ALIGNMENT / sizeof(float)) * (SIMD_ALIGNMENT / sizeof(float));
+		m_adapted.assign(2 * MAX_MICROPHONES * m_stride, 0.f);
+		m_constraint.assign(2 * MAX_MICROPHONES * m_stride, 0.f);
+		m_soa_input.assign(2 * MAX_MICROPHONES * m_stride, 0.f);
+		m_nu.assign(m_stride, ADAPTIVE_NU);
+		m_mu.assign(m_stride, ADAPTIVE_MU);
 		// initialize kinect weights
 		std::complex<float> zero(0.f, 0.f);
-		float freq_step = (float)SAMPLE_RATE / FRAME_SIZE / 2.f;
+		float freq_step = (float)SAMPLE_RATE / frame_size / 2.f;
 		float freq_beg = freq_step / 2.f;
 		for (int beam = 0; beam < MAX_BEAMS; ++beam){
 			int interp_low = 0;
@@ -22,7 +197,7 @@ namespace Beam{
 				++interp_high;
 				++interp_low;
 			}
-			for (int bin = 0; bin < FRAME_SIZE; ++bin){
+			for (int bin = 0; bin < frame_size; ++bin){
 				float freq = freq_beg + bin * freq_step;
 				if (freq > KinectConfig::kinect_descriptor.freq_high){
 					freq = KinectConfig::kinect_descriptor.freq_high;
@@ -35,8 +210,7 @@ namespace Beam{
 				// special case 1.  Frequency is less than dFreq_Lo --- set value to 0
 				if (freq <= KinectConfig::kinect_descriptor.freq_low){
 					for (int channel = 0; channel < MAX_MICROPHONES; ++channel){
-						m_pcm_weights[beam][channel][bin].real(0.f);
-						m_pcm_weights[beam][channel][bin].imag(0.f);
+						weight_at(beam, bin, channel) = std::complex<float>(0.f, 0.f);
 					}
 				}
 				// Special Case 2 - interpolate between 0 and freqency
@@ -44,10 +218,10 @@ namespace Beam{
 					int freq_index = KinectConfig::kinect_weights.frequencies[interp_low] > KinectConfig::kinect_descriptor.freq_low ? interp_low : interp_high;
 					t = (freq - KinectConfig::kinect_descriptor.freq_low) / (KinectConfig::kinect_weights.frequencies[freq_index] - KinectConfig::kinect_descriptor.freq_low);
 					for (int channel = 0; channel < MAX_MICROPHONES; ++channel){
-						int weight_index = beam * FRAME_SIZE * MAX_MICROPHONES;
+						int weight_index = beam * KinectConfig::kinect_weights.num_frequency_bins * KinectConfig::kinect_weights.num_channels;
 						weight_index += freq_index * KinectConfig::kinect_weights.num_channels;
 						weight_index += channel;
-						m_pcm_weights[beam][channel][bin] = Utils::interpolate(zero, KinectConfig::kinect_weights.weights[weight_index + KinectConfig::kinect_weights.num_channels], t);
+						weight_at(beam, bin, channel) = Utils::interpolate(zero, KinectConfig::kinect_weights.weights[weight_index + KinectConfig::kinect_weights.num_channels], t);
 					}
 				}
 				// special case 3, no need to interpolate
@@ -57,7 +231,7 @@ namespace Beam{
 						int weight_index = beam * KinectConfig::kinect_weights.num_frequency_bins * KinectConfig::kinect_weights.num_channels;
 						weight_index += freq_index * KinectConfig::kinect_weights.num_channels;
 						weight_index += channel;
-						m_pcm_weights[beam][channel][bin] = KinectConfig::kinect_weights.weights[weight_index];
+						weight_at(beam, bin, channel) = KinectConfig::kinect_weights.weights[weight_index];
 					}
 				}
 				// standard case  | here we need to interpolate the values
@@ -66,18 +240,14 @@ namespace Beam{
 						int weight_index = beam * KinectConfig::kinect_weights.num_frequency_bins * KinectConfig::kinect_weights.num_channels;
 						weight_index += interp_low * KinectConfig::kinect_weights.num_channels;
 						weight_index += channel;
-						m_pcm_weights[beam][channel][bin] = Utils::interpolate(KinectConfig::kinect_weights.weights[weight_index], KinectConfig::kinect_weights.weights[weight_index + KinectConfig::kinect_weights.num_channels], t);
+						weight_at(beam, bin, channel) = Utils::interpolate(KinectConfig::kinect_weights.weights[weight_index], KinectConfig::kinect_weights.weights[weight_index + KinectConfig::kinect_weights.num_channels], t);
 					}
 				}
 			}
 		}
 	}
 
-	Beamformer::~Beamformer(){
-	
-	}
-
-	void Beamformer::compute(std::vector<std::complex<float> >* input, std::vector<std::complex<float> >& output, float angle, float confidence, double time){
+	int Beamformer::select_beam(float angle, float confidence){
 		//  we have sound source detected - single beam mode
 		// find the best beam
 		if (confidence > SSL_BEAMCHANGE_CONFIDENCE_THRESHOLD){
@@ -117,50 +287,87 @@ namespace Beam{
 				}
 			}
 		}
-		for (int bin = 0; bin < m_first_bin; ++bin){
-			output[bin].real(0.f);
-			output[bin].imag(0.f);
+		return m_beam;
+	}
+
+	void Beamformer::set_adaptive(bool adaptive){
+		m_adaptive = adaptive;
+		m_adapted_beam = -1;
+	}
+
+	void Beamformer::set_adaptation(int bin, float nu, float mu){
+		m_nu[bin] = nu;
+		m_mu[bin] = mu;
+	}
+
+	void Beamformer::set_adaptation(float nu, float mu){
+		for (int bin = 0; bin < m_frame_size; ++bin){
+			set_adaptation(bin, nu, mu);
+		}
+	}
+
+	void Beamformer::reset_adaptation(){
+		// the steering vectors are given for the bins of FRAME_SIZE, other frame sizes take the closest frequency.
+		const size_t im = MAX_MICROPHONES * m_stride;
+		for (int bin = 0; bin < m_frame_size; ++bin){
+			int dd_bin = std::min(FRAME_SIZE - 1, (int)((bin + 0.5f) * FRAME_SIZE / m_frame_size));
+			const std::complex<float>* dd = KinectConfig::kinect_weights.dd + ((size_t)m_beam * FRAME_SIZE + dd_bin) * MAX_MICROPHONES;
+			for (int channel = 0; channel < MAX_MICROPHONES; ++channel){
+				const size_t re = channel * m_stride + bin;
+				m_adapted[re] = weight(m_beam, bin, channel).real();
+				m_adapted[re + im] = weight(m_beam, bin, channel).imag();
+				m_constraint[re] = dd[channel].real();
+				m_constraint[re + im] = dd[channel].imag();
+			}
 		}
+		m_adapted_beam = m_beam;
+	}
+
+	void Beamformer::interleave(std::vector<std::complex<float> >* input){
 		for (int bin = m_first_bin; bin < m_last_bin; ++bin){
-			output[bin].real(0.f);
-			output[bin].imag(0.f);
 			for (int channel = 0; channel < MAX_MICROPHONES; ++channel){
-				output[bin] += m_pcm_weights[m_beam][channel][bin] * input[channel][bin];
+				m_input[bin * MAX_MICROPHONES + channel] = input[channel][bin];
 			}
 		}
-		for (int bin = m_last_bin; bin < FRAME_SIZE; ++bin){
-			output[bin].real(0.f);
-			output[bin].imag(0.f);
+	}
+
+	void Beamformer::compute(std::vector<std::complex<float> >* input, std::vector<std::complex<float> >& output, float angle, float confidence, double time){
+		interleave(input);
+		compute(&m_input[0], &output[0], angle, confidence, time);
+	}
+
+	void Beamformer::compute(const std::complex<float>* input, std::complex<float>* output, float angle, float confidence, double time){
+		select_beam(angle, confidence);
+		if (!m_adaptive){
+			compute_beams(input, &output, &m_beam, 1);
+			return;
+		}
+		if (m_adapted_beam != m_beam){
+			reset_adaptation();
 		}
-		// adaptive beam
-		//int beg_bin = 6;
-		//int end_bin = 225;
-		//for (int bin = beg_bin; bin <= end_bin; ++bin){
-		//	std::complex<float> wo0, wo1, wo2, wo3;
-		//	std::complex<float> m0, m1, m2, m3;
-		//	std::complex<float> w0, w1, w2, w3;
-		//	std::complex<float> scale(F2RAISED23_INV, 0.f);
-		//	int weight_index = m_beam * FRAME_SIZE * MAX_MICROPHONES + bin * MAX_MICROPHONES;
+		const size_t im = MAX_MICROPHONES * m_stride;
+		for (int bin = m_first_bin; bin < m_last_bin; ++bin){
+			for (int channel = 0; channel < MAX_MICROPHONES; ++channel){
+				m_soa_input[channel * m_stride + bin] = input[bin * MAX_MICROPHONES + channel].real();
+				m_soa_input[channel * m_stride + bin + im] = input[bin * MAX_MICROPHONES + channel].imag();
+			}
+		}
+		std::fill(output, output + m_first_bin, std::complex<float>(0.f, 0.f));
+		std::fill(output + m_last_bin, output + m_frame_size, std::complex<float>(0.f, 0.f));
+		adapt(&m_adapted[0], &m_constraint[0], &m_soa_input[0], &m_nu[0], &m_mu[0], output, m_stride, m_first_bin, m_last_bin);
+	}
+
+	void Beamformer::compute_beams(std::vector<std::complex<float> >* input, std::complex<float>* const* outputs, const int* beams, int num_beams){
+		interleave(input);
+		compute_beams(&m_input[0], outputs, beams, num_beams);
+	}
 
-		//	m0 = input[0][bin] * scale;
-		//	m1 = input[1][bin] * scale;
-		//	m2 = input[2][bin] * scale;
-		//	m3 = input[3][bin] * scale;
-		//	w0 = (KinectConfig::kinect_weights.dd + weight_index)[0];
-		//	w1 = (KinectConfig::kinect_weights.dd + weight_index)[1];
-		//	w2 = (KinectConfig::kinect_weights.dd + weight_index)[2];
-		//	w3 = (KinectConfig::kinect_weights.dd + weight_index)[3];
-		//	wo0 = m_pcm_weights[m_beam][0][bin];
-		//	wo1 = m_pcm_weights[m_beam][1][bin];
-		//	wo2 = m_pcm_weights[m_beam][2][bin];
-		//	wo3 = m_pcm_weights[m_beam][3][bin];
-		//	ansi_bf_msr_process_quad_loop_fast(&wo0, &wo1, &wo2, &wo3, m0, m1, m2, m3, w0, w1, w2, w3, 0.0000010f, 0.0080000f);
-		//	// Update working weights
-		//	m_pcm_weights[m_beam][0][bin] = wo0;
-		//	m_pcm_weights[m_beam][1][bin] = wo1;
-		//	m_pcm_weights[m_beam][2][bin] = wo2;
-		//	m_pcm_weights[m_beam][3][bin] = wo3;
-		//}
+	void Beamformer::compute_beams(const std::complex<float>* input, std::complex<float>* const* outputs, const int* beams, int num_beams){
+		for (int row = 0; row < num_beams; ++row){
+			std::fill(outputs[row], outputs[row] + m_first_bin, std::complex<float>(0.f, 0.f));
+			std::fill(outputs[row] + m_last_bin, outputs[row] + m_frame_size, std::complex<float>(0.f, 0.f));
+		}
+		filter(&m_weights[0], (size_t)m_frame_size * MAX_MICROPHONES, beams, num_beams, input, outputs, m_first_bin, m_last_bin);
 	}
 
 	void Beamformer::ansi_bf_msr_process_quad_loop_fast(std::complex<float>* wo0, std::complex<float>* wo1, std::complex<float>* wo2, std::complex<float>* wo3, std::complex<float>& m0, std::complex<float>& m1, std::complex<float>& m2, std::complex<float>& m3, std::complex<float>& w0, std::complex<float>& w1, std::complex<float>& w2, std::complex<float>& w3, float nu, float mu){
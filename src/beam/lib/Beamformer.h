@@ -7,17 +7,74 @@
 
 namespace Beam{
 #define F2RAISED23_INV (1.0f/8388608.0f)
+// defaults of the adaptive mode: regularization nu and step size mu of the weight update.
+#define ADAPTIVE_NU 0.0000010f
+#define ADAPTIVE_MU 0.0080000f
+	/// fixed beams of the kinect array. the beam closest to the sound source filters the channels:
+	/// output[bin] is the sum over the channels of weight(beam, bin, channel) * input[channel][bin].
+	/// the weights are one aligned tensor [beam][bin][channel], so the weights of a bin are 4 adjacent complex numbers,
+	/// and the filter runs on an input interleaved the same way, with an AVX2/FMA kernel where the cpu has it.
+	/// compute_beams runs any set of beams on the same input in one pass, e.g. all of them for a rescoring downstream.
+	/// in the adaptive mode the weights of the beam in use move every frame towards the MVDR weights of the frame,
+	/// with the steering vectors of KinectConfig::kinect_dd as the constraint, see ansi_bf_msr_process_quad_loop_fast.
+	/// that state is structure of arrays, one row of bins per real and imaginary part of every channel,
+	/// so the update runs on 8 bins per AVX2/FMA instruction.
 	class Beamformer {
 	public:
-		Beamformer();
-		~Beamformer();
+		Beamformer(int frame_size = FRAME_SIZE);
 		void compute(std::vector<std::complex<float> >* input, std::vector<std::complex<float> >& output, float angle, float confidence, double time);
+		/// the same on an interleaved input: input[bin * MAX_MICROPHONES + channel]. output receives frame_size bins.
+		void compute(const std::complex<float>* input, std::complex<float>* output, float angle, float confidence, double time);
+		/// the beams beams[0 ... num_beams) of KinectConfig::kinect_beams at once, wherever the sound source is:
+		/// outputs[row] receives frame_size bins of beam beams[row]. every bin is the product of the beams x channels
+		/// matrix of its weights with its channel vector, which is loaded once for all the beams.
+		void compute_beams(const std::complex<float>* input, std::complex<float>* const* outputs, const int* beams, int num_beams);
+		void compute_beams(std::vector<std::complex<float> >* input, std::complex<float>* const* outputs, const int* beams, int num_beams);
+		/// pick the beam for a sound source at angle with the hysteresis of compute, and return it.
+		int select_beam(float angle, float confidence);
+		/// the beam in use.
+		int beam() const { return m_beam; }
+		/// the bins from first_bin() to last_bin() - 1 are filtered, the others are 0.
+		int first_bin() const { return m_first_bin; }
+		int last_bin() const { return m_last_bin; }
+		std::complex<float> weight(int beam, int bin, int channel) const { return m_weights[((size_t)beam * m_frame_size + bin) * MAX_MICROPHONES + channel]; }
+		/// switch the adaptive mode of compute. the adaptation starts from the fixed weights of the beam in use
+		/// and starts over when the beam changes.
+		void set_adaptive(bool adaptive);
+		bool adaptive() const { return m_adaptive; }
+		/// regularization nu and step size mu of the adaptation of bin, ADAPTIVE_NU and ADAPTIVE_MU by default.
+		/// mu 0 keeps the weights of the bin, 1 replaces them with the MVDR weights of every frame.
+		void set_adaptation(int bin, float nu, float mu);
+		/// the same for all bins.
+		void set_adaptation(float nu, float mu);
+		/// the weight of the adaptive mode, which compute uses for the next frame.
+		std::complex<float> adapted_weight(int bin, int channel) const { return std::complex<float>(m_adapted[channel * m_stride + bin], m_adapted[(MAX_MICROPHONES + channel) * m_stride + bin]); }
+		/// the steering vector of the beam in use that constrains the adaptation.
+		std::complex<float> constraint(int bin, int channel) const { return std::complex<float>(m_constraint[channel * m_stride + bin], m_constraint[(MAX_MICROPHONES + channel) * m_stride + bin]); }
+		/// one step of the adaptation of one bin of the 4 microphones: m0 ... m3 is the input, w0 ... w3 the constraint,
+		/// wo0 ... wo3 the weights to update. the adaptive mode computes the same on structure of arrays.
 		void ansi_bf_msr_process_quad_loop_fast(std::complex<float>* wo0, std::complex<float>* wo1, std::complex<float>* wo2, std::complex<float>* wo3, std::complex<float>& m0, std::complex<float>& m1, std::complex<float>& m2, std::complex<float>& m3, std::complex<float>& w0, std::complex<float>& w1, std::complex<float>& w2, std::complex<float>& w3, float nu, float mu);
 	private:
+		// copy the first..last bins of the channels into m_input.
+		void interleave(std::vector<std::complex<float> >* input);
+		std::complex<float>& weight_at(int beam, int bin, int channel) { return m_weights[((size_t)beam * m_frame_size + bin) * MAX_MICROPHONES + channel]; }
+		// load the fixed weights and the steering vector of the beam in use into the adaptive state.
+		void reset_adaptation();
+		int m_frame_size;
 		int m_beam;
 		int m_first_bin;
 		int m_last_bin;
-		std::vector<std::complex<float> > m_pcm_weights[MAX_BEAMS][MAX_MICROPHONES];
+		AlignedVector<std::complex<float> > m_weights; // [beam][bin][channel]
+		AlignedVector<std::complex<float> > m_input; // the interleaved input of compute on channel vectors.
+		// adaptive mode. the rows have m_stride bins, the real parts of the channels come before the imaginary parts.
+		bool m_adaptive;
+		int m_adapted_beam; // the beam of m_adapted and m_constraint, -1 before the first frame.
+		size_t m_stride;
+		AlignedVector<float> m_adapted; // [re/im][channel][bin]
+		AlignedVector<float> m_constraint; // [re/im][channel][bin]
+		AlignedVector<float> m_soa_input; // [re/im][channel][bin]
+		AlignedVector<float> m_nu; // [bin]
+		AlignedVector<float> m_mu; // [bin]
 	};
 }
 
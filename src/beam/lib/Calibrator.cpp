@@ -1,17 +1,13 @@
 #include "Calibrator.h"
 
 namespace Beam{
-	Calibrator::Calibrator(){
+	Calibrator::Calibrator(int frame_size) : m_frame_size(frame_size){
 		// initialize m_frequency_filter.
 		for (int sub = 0; sub < MAX_GAIN_SUBBANDS; ++sub){
-			DSPFilter::band_pass_mclt(m_frequency_filter[sub], KinectConfig::frequency_bands[sub][1] / SAMPLE_RATE, KinectConfig::frequency_bands[sub][0] / SAMPLE_RATE, KinectConfig::frequency_bands[sub][0] / SAMPLE_RATE, KinectConfig::frequency_bands[sub][2] / SAMPLE_RATE);
+			DSPFilter::band_pass_mclt(m_frequency_filter[sub], KinectConfig::frequency_bands[sub][1] / SAMPLE_RATE, KinectConfig::frequency_bands[sub][0] / SAMPLE_RATE, KinectConfig::frequency_bands[sub][0] / SAMPLE_RATE, KinectConfig::frequency_bands[sub][2] / SAMPLE_RATE, frame_size);
 		}
 		// initialize m_working_frequency.
-		m_working_frequency.assign(FRAME_SIZE, std::complex<float>(0.f, 0.f));
-	}
-
-	Calibrator::~Calibrator(){
-	
+		m_working_frequency.assign(frame_size, std::complex<float>(0.f, 0.f));
 	}
 
 	float Calibrator::calibrate(float sound_source, std::vector<std::complex<float> >* input, std::complex<float> persistent_gains[MAX_MICROPHONES][MAX_GAIN_SUBBANDS]){
@@ -30,7 +26,7 @@ namespace Beam{
 		}
 		for (int sub = 0; sub < MAX_GAIN_SUBBANDS; ++sub){
 			for (int channel = 0; channel < MAX_MICROPHONES; ++channel){
-				for (int bin = 0; bin < FRAME_SIZE; ++bin){
+				for (int bin = 0; bin < m_frame_size; ++bin){
 					m_working_frequency[bin] = input[channel][bin] * m_frequency_filter[sub][bin];
 				}
 				channel_rms[channel] = Utils::computeRMS(m_working_frequency);
@@ -8,10 +8,10 @@
 namespace Beam{
 	class Calibrator {
 	public:
-		Calibrator();
-		~Calibrator();
+		Calibrator(int frame_size = FRAME_SIZE);
 		float calibrate(float sound_source, std::vector<std::complex<float> >* input, std::complex<float> persistent_gains[MAX_MICROPHONES][MAX_GAIN_SUBBANDS]);
 	private:
+		int m_frame_size;
 		float m_coordinates[MAX_MICROPHONES];
 		float m_coeff[2];
 		std::vector<std::complex<float> > m_frequency_filter[MAX_GAIN_SUBBANDS];
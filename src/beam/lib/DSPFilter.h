@@ -13,11 +13,12 @@ namespace Beam{
 		/// filters using MCLT.
 		static void low_pass_mclt(std::vector<std::complex<float> >& spectrum, float pass_freq, float stop_freq);
 		static void high_pass_mclt(std::vector<std::complex<float> >& spectrum, float pass_freq, float stop_freq);
-		static void band_pass_mclt(std::vector<std::complex<float> >& spectrum, float low_stop_freq, float low_pass_freq, float high_pass_freq, float high_stop_freq);
+		/// the band pass filters are created with the given number of bins.
+		static void band_pass_mclt(std::vector<std::complex<float> >& spectrum, float low_stop_freq, float low_pass_freq, float high_pass_freq, float high_stop_freq, int bins = FRAME_SIZE);
 		/// filters using FFT.
 		static void low_pass_fft(std::vector<std::complex<float> >& spectrum, float pass_freq, float stop_freq);
 		static void high_pass_fft(std::vector<std::complex<float> >& spectrum, float pass_freq, float stop_freq);
-		static void band_pass_fft(std::vector<std::complex<float> >& spectrum, float low_stop_freq, float low_pass_freq, float high_pass_freq, float high_stop_freq);
+		static void band_pass_fft(std::vector<std::complex<float> >& spectrum, float low_stop_freq, float low_pass_freq, float high_pass_freq, float high_stop_freq, int bins = FRAME_SIZE);
 
 	};
 }
@@ -1,23 +1,28 @@
 #include "DeReverb.h"
 
 namespace Beam{
-	DeReverb::DeReverb() : m_voice_frame_count(0), m_voice_found(false), m_tail_found(false), m_tail_count(0){
-		m_cepstral_mean.assign(FRAME_SIZE, std::complex<float>(0.f, 0.f));
-		m_init_energy.assign(FRAME_SIZE, -1.f);
-		for (int i = 0; i < FRAME_SIZE; ++i){
-			m_energy[i].assign(TAIL_FRAME_SIZE, 0.f);
-		}
-		m_tau.assign(FRAME_SIZE, 0.02f);
-		m_energy_list.assign(FRAME_SIZE, std::list<float>());
+	DeReverb::DeReverb(int frame_size){
+		init(frame_size);
 	}
 
-	DeReverb::~DeReverb(){
-	
+	void DeReverb::init(int frame_size){
+		m_frame_size = frame_size;
+		m_voice_frame_count = 0;
+		m_voice_found = false;
+		m_tail_found = false;
+		m_tail_count = 0;
+		m_cepstral_mean.assign(frame_size, std::complex<float>(0.f, 0.f));
+		m_init_energy.assign(frame_size, -1.f);
+		m_energy.assign(frame_size, std::vector<float>(TAIL_FRAME_SIZE, 0.f));
+		m_tau.assign(frame_size, 0.02f);
+		m_energy_history.assign(frame_size * TAIL_FRAME_SIZE, 0.f);
+		m_energy_next.assign(frame_size, 0);
+		m_energy_count.assign(frame_size, 0);
 	}
 
 	void DeReverb::normalize_cepstral(std::vector<std::complex<float> >& input, bool voice_found){
 		if (voice_found){
-			for (int bin = 0; bin < FRAME_SIZE; ++bin){
+			for (int bin = 0; bin < m_frame_size; ++bin){
 				std::complex<float> cepstral;
 				float scale = Utils::abs_complex(input[bin]);
 				if (scale > 0.f){
@@ -41,7 +46,7 @@ namespace Beam{
 	}
 
 	void DeReverb::suppress(std::vector<std::complex<float> >& input){
-		for (int bin = 0; bin < FRAME_SIZE; ++bin){
+		for (int bin = 0; bin < m_frame_size; ++bin){
 			float energy = Utils::norm_complex(input[bin]);
 			if (energy == 0.f){
 				continue;
@@ -52,13 +57,12 @@ namespace Beam{
 			else{
 				m_init_energy[bin] = 0.9f * m_init_energy[bin] + 0.1f * energy;
 			}
-			m_energy_list[bin].push_back(m_init_energy[bin]);
-			if (m_energy_list[bin].size() > TAIL_FRAME_SIZE){
-				m_energy_list[bin].pop_front();
-			}
-			if (m_energy_list[bin].size() == TAIL_FRAME_SIZE){
-				auto iter = m_energy_list[bin].begin();
-				float xx = *iter++;
+			float* history = &m_energy_history[bin * TAIL_FRAME_SIZE];
+			history[m_energy_next[bin]] = m_init_energy[bin];
+			m_energy_next[bin] = (m_energy_next[bin] + 1) % TAIL_FRAME_SIZE;
+			m_energy_count[bin] = std::min(m_energy_count[bin] + 1, TAIL_FRAME_SIZE);
+			if (m_energy_count[bin] == TAIL_FRAME_SIZE){
+				float xx = history[m_energy_next[bin]]; // the oldest energy.
 				float rr = expf(-3.f * 10.62f * 0.05f) * xx;
 				float s = Utils::abs_complex(input[bin]);
 				float sqrt_rr = sqrtf(rr);
@@ -128,7 +132,7 @@ namespace Beam{
 		if (init_energy == 0.f){
 			return 0.02f;
 		}
-		float t = (float)FRAME_SIZE / SAMPLE_RATE;
+		float t = (float)m_frame_size / SAMPLE_RATE;
 		float tau_inv = 0.f;
 		int valid_count = 0;
 		float log_init_energy = logf(init_energy);
@@ -148,7 +152,7 @@ namespace Beam{
 	}
 
 	void DeReverb::update_tau(const std::vector<float>& tau){
-		for (int bin = 0; bin < FRAME_SIZE; ++bin){
+		for (int bin = 0; bin < m_frame_size; ++bin){
 			if (m_tau[bin] == 0.f){
 				m_tau[bin] = tau[bin];
 			}
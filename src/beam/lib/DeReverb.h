@@ -3,15 +3,15 @@
 
 #include "GlobalConfig.h"
 #include "Utils.h"
-#include <list>
 
 #define TAIL_FRAME_SIZE 3
 
 namespace Beam{
 	class DeReverb {
 	public:
-		DeReverb();
-		~DeReverb();
+		DeReverb(int frame_size = FRAME_SIZE);
+		/// reset the state for frames of frame_size bins.
+		void init(int frame_size);
 		// cepstral mean subtraction.
 		void normalize_cepstral(std::vector<std::complex<float> >& input, bool voice_found);
 		// reverbration suppression.
@@ -20,15 +20,20 @@ namespace Beam{
 		float compute_tau(float init_energy, const std::vector<float>& tail_energy);
 		void update_tau(const std::vector<float>& tau);
 	private:
+		int m_frame_size;
 		std::vector<std::complex<float> > m_cepstral_mean;
 		int m_voice_frame_count;
 		bool m_voice_found;
 		bool m_tail_found;
 		int m_tail_count;
 		std::vector<float> m_init_energy;
-		std::vector<float> m_energy[FRAME_SIZE];
+		std::vector<std::vector<float> > m_energy;
 		std::vector<float> m_tau;
-		std::vector<std::list<float> > m_energy_list;
+		// the last TAIL_FRAME_SIZE smoothed energies of every bin, a ring per bin:
+		// bin * TAIL_FRAME_SIZE + m_energy_next[bin] is the oldest once m_energy_count[bin] is TAIL_FRAME_SIZE.
+		std::vector<float> m_energy_history;
+		std::vector<int> m_energy_next;
+		std::vector<int> m_energy_count;
 	};
 }
 
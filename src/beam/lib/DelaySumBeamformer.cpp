@@ -1,7 +1,7 @@
 #include "DelaySumBeamformer.h"
 
 namespace Beam{
-	DelaySumBeamformer::DelaySumBeamformer(){
+	DelaySumBeamformer::DelaySumBeamformer(int frame_size) : m_steering(SteeringVectors::get(frame_size)){
 
 	}
 
@@ -10,18 +10,12 @@ namespace Beam{
 	}
 
 	void DelaySumBeamformer::compute(std::vector<std::complex<float> >* input, std::vector<std::complex<float> >& output, float angle, float confidence, double time){
-		// compute time delay
-		float time_delay[AVALABLE_MICROPHONES] = { 0.f };
-		for (int channel = 0; channel < AVALABLE_MICROPHONES; ++channel){
-			float distance = KinectConfig::kinect_descriptor.mic[channel].y * sinf(angle);
-			time_delay[channel] = distance / (float)SOUND_SPEED;
-		}
-		for (int bin = 0; bin < FRAME_SIZE; ++bin){
+		const std::complex<float>* steering = m_steering.vector(angle);
+		int bins = m_steering.frame_size();
+		for (int bin = 0; bin < bins; ++bin){
 			std::complex<float> sum(0.f, 0.f);
-			float rad_freq = (float)(-bin * TWO_PI * SAMPLE_RATE / FRAME_SIZE / 2.f);
 			for (int channel = 0; channel < AVALABLE_MICROPHONES; ++channel){
-				float v = (float)(rad_freq * time_delay[channel]);
-				sum += input[channel][bin] * std::complex<float>(cosf(v), sinf(v));
+				sum += input[channel][bin] * steering[bin * MAX_MICROPHONES + channel];
 			}
 			sum /= (float)AVALABLE_MICROPHONES;
 			output[bin] = sum;
@@ -3,15 +3,17 @@
 
 #include "KinectConfig.h"
 #include "SoundSourceLocalizer.h"
+#include "SteeringVectors.h"
 
 namespace Beam{
+	/// delay and sum towards the sound source, with the steering vectors of the shared SteeringVectors cache.
 	class DelaySumBeamformer {
 	public:
-		DelaySumBeamformer();
+		DelaySumBeamformer(int frame_size = FRAME_SIZE);
 		~DelaySumBeamformer();
 		void compute(std::vector<std::complex<float> >* input, std::vector<std::complex<float> >& output, float angle, float confidence, double time);
 	private:
-
+		const SteeringVectors& m_steering;
 	};
 }
 
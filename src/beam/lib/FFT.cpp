@@ -1,100 +1,151 @@
 #include "FFT.h"
 
+// sse is part of every x86-64 cpu. the batched transforms use it for groups of 4 channels.
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#define BEAM_BATCH_SSE
+#include <xmmintrin.h>
+#endif
+
 namespace Beam{
-	float FFT::wr_15[15] = {  // cos(2*pi*(0:14)/15)
-		1.0f, 0.9135454576f, 0.6691306063f, 0.3090169943f, -0.1045284632f,
-		-0.5f, -0.8090169943f, -0.9781476007f, -0.9781476007f, -0.8090169943f,
-		-0.5f, -0.1045284632f, 0.3090169943f, 0.6691306063f, 0.9135454576f };
-	float FFT::wi_15[15] = {  // -sin(2*pi*(0:14)/15)
-		0.0f, -0.4067366430f, -0.7431448254f, -0.9510565162f, -0.9945218953f,
-		-0.8660254037f, -0.5877852522f, -0.2079116908f, 0.2079116908f, 0.5877852522f,
-		0.8660254037f, 0.9945218953f, 0.9510565162f, 0.7431448254f, 0.4067366430f };
-
-
-	FFT::FFT(){
-		for (int i = 0; i < TWO_FRAME_SIZE; ++i){
-			m_ha[i] = sinf(i * (float)PI / TWO_FRAME_SIZE);
+	// prime factor mapping of the 15 point transforms, 15 = 3 * 5 (Good-Thomas).
+	// row n2 holds the time indices (5 * n1 + 3 * n2) % 15 for n1 = 0, 1, 2. with the frequency index
+	// k = (10 * k1 + 6 * k2) % 15 the transform splits into 3 and 5 point transforms without twiddles.
+	const int FFT::map_15[5][3] = { { 0, 5, 10 }, { 3, 8, 13 }, { 6, 11, 1 }, { 9, 14, 4 }, { 12, 2, 7 } };
+
+
+	FFT::FFT(int frame_size) : m_frame_size(frame_size), m_plan(2 * frame_size){
+		int two_frame_size = 2 * frame_size;
+		m_ha.assign(two_frame_size, 0.f);
+		for (int i = 0; i < two_frame_size; ++i){
+			m_ha[i] = sinf(i * (float)PI / two_frame_size);
 		}
-		std::fill(m_prev, m_prev + FRAME_SIZE, 0.f);
-		std::fill(m_input_prev, m_input_prev + FRAME_SIZE, 0.f);
-	}
-	FFT::~FFT(){
-	
+		m_prev.assign(frame_size, 0.f);
+		m_out.assign(two_frame_size, 0.f);
 	}
 
-	void FFT::analyze(std::vector<float>& input, std::vector<std::complex<float> >& output){
-		float out[TWO_FRAME_SIZE];
-		for (int i = 0; i < FRAME_SIZE; ++i){
-			m_input[i] = m_input_prev[i];
-		}
-		for (int i = FRAME_SIZE; i < TWO_FRAME_SIZE; ++i){
-			m_input[i] = input[i - FRAME_SIZE];
-		}
-		for (int i = 0; i < TWO_FRAME_SIZE; ++i){
-			m_input[i] *= m_ha[i];
-		}
-		AecCcsFwdFFT(m_input, out, true);
+	void FFT::analyze(const float* input, std::complex<float>* output){
+		int two_frame_size = 2 * m_frame_size;
+		float* out = &m_out[0];
+		AecCcsFwdFFT(m_plan, const_cast<float*>(input), out, true, &m_ha[0]);
 		// only copy the first half
-		for (int i = 0; i < FRAME_SIZE; ++i){
-			output[i].real(out[i]);
-		}
-		for (int i = FRAME_SIZE + 1; i < TWO_FRAME_SIZE; ++i){
-			output[TWO_FRAME_SIZE - i].imag(out[i]);
+		output[0] = std::complex<float>(out[0], 0.f);
+		for (int i = 1; i < m_frame_size; ++i){
+			output[i] = std::complex<float>(out[i], out[two_frame_size - i]);
 		}
-		output[0].imag(0.f);
-		std::copy(input.begin(), input.end(), m_input_prev);
 	}
 
-	void FFT::synthesize(std::vector<std::complex<float> >& input, std::vector<float>& output){
-		float in[TWO_FRAME_SIZE] = { 0.f };
-		for (int i = 0; i < FRAME_SIZE; ++i){
+	void FFT::synthesize(const std::complex<float>* input, float* output){
+		int two_frame_size = 2 * m_frame_size;
+		float* in = &m_out[0];
+		in[0] = input[0].real();
+		in[m_frame_size] = 0.f;
+		for (int i = 1; i < m_frame_size; ++i){
 			in[i] = input[i].real();
+			in[two_frame_size - i] = input[i].imag();
 		}
-		for (int i = FRAME_SIZE + 1; i < TWO_FRAME_SIZE; ++i){
-			in[i] = input[TWO_FRAME_SIZE - i].imag();
-		}
-		AecCcsInvFFT(in, m_current, true);
-		for (int i = 0; i < TWO_FRAME_SIZE; ++i){
-			m_current[i] /= (float)TWO_FRAME_SIZE;
-		}
-		for (int i = 0; i < TWO_FRAME_SIZE; ++i){
-			m_current[i] *= m_ha[i];
-		}
-		// first half
-		for (int i = 0; i < FRAME_SIZE; ++i){
-			output[i] = m_prev[i] + m_current[i];
-		}
-		std::copy(m_current + FRAME_SIZE, m_current + TWO_FRAME_SIZE, m_prev);
+		AecCcsInvFFTOverlapAdd(m_plan, in, true, 1.f / (float)two_frame_size, &m_ha[0], &m_prev[0], output);
 	}
 
+	// Forward base transform for FFT size of 15
+	// xout[0] = X0, xout[k] = Re Xk and xout[15 - k] = Im Xk for k = 1..7.
 	void FFT::FwdFFT_base15(float * xin, float * xout){
-		int i, j;
-		xout[0] = xin[0] + xin[1] + xin[2] + xin[3] + xin[4] + xin[5] + xin[6] + xin[7] +
-			xin[8] + xin[9] + xin[10] + xin[11] + xin[12] + xin[13] + xin[14];
-		for (i = 1; i<8; i++){
-			xout[i] = xin[0];
-			xout[15 - i] = 0;
-			for (j = 1; j<15; j++){
-				xout[i] += xin[j] * wr_15[(i*j) % 15];
-				xout[15 - i] += xin[j] * wi_15[(i*j) % 15];
-			}
+		const float s3 = 0.8660254038f;   // sin(2*pi/3)
+		const float c51 = 0.3090169944f;  // cos(2*pi/5)
+		const float c52 = -0.8090169944f; // cos(4*pi/5)
+		const float s51 = 0.9510565163f;  // sin(2*pi/5)
+		const float s52 = 0.5877852523f;  // sin(4*pi/5)
+		float a0[5], a1r[5], a1i[5];
+		int n2;
+
+		// 3 point transforms over n1. a0 is real, the third output is the conjugate of a1.
+		for (n2 = 0; n2 < 5; n2++){
+			float x0 = xin[map_15[n2][0]];
+			float x1 = xin[map_15[n2][1]];
+			float x2 = xin[map_15[n2][2]];
+			a0[n2] = x0 + x1 + x2;
+			a1r[n2] = x0 - 0.5f * (x1 + x2);
+			a1i[n2] = s3 * (x2 - x1);
 		}
+
+		// real 5 point transform of a0 gives X0, X6 and conj(X3).
+		float t1 = a0[1] + a0[4];
+		float t2 = a0[2] + a0[3];
+		float t3 = a0[1] - a0[4];
+		float t4 = a0[2] - a0[3];
+		xout[0] = a0[0] + t1 + t2;
+		xout[6] = a0[0] + c51 * t1 + c52 * t2;
+		xout[9] = -(s51 * t3 + s52 * t4);
+		xout[3] = a0[0] + c52 * t1 + c51 * t2;
+		xout[12] = s52 * t3 - s51 * t4;
+
+		// complex 5 point transform of a1 gives conj(X5), X1, X7, conj(X2) and X4.
+		float t1r = a1r[1] + a1r[4], t1i = a1i[1] + a1i[4];
+		float t2r = a1r[2] + a1r[3], t2i = a1i[2] + a1i[3];
+		float t3r = a1r[1] - a1r[4], t3i = a1i[1] - a1i[4];
+		float t4r = a1r[2] - a1r[3], t4i = a1i[2] - a1i[3];
+		float m1r = a1r[0] + c51 * t1r + c52 * t2r, m1i = a1i[0] + c51 * t1i + c52 * t2i;
+		float m2r = a1r[0] + c52 * t1r + c51 * t2r, m2i = a1i[0] + c52 * t1i + c51 * t2i;
+		float n1r = s51 * t3r + s52 * t4r, n1i = s51 * t3i + s52 * t4i;
+		float n2r = s52 * t3r - s51 * t4r, n2i = s52 * t3i - s51 * t4i;
+		xout[5] = a1r[0] + t1r + t2r;
+		xout[10] = -(a1i[0] + t1i + t2i);
+		xout[1] = m1r + n1i;
+		xout[14] = m1i - n1r;
+		xout[4] = m1r - n1i;
+		xout[11] = m1i + n1r;
+		xout[7] = m2r + n2i;
+		xout[8] = m2i - n2r;
+		xout[2] = m2r - n2i;
+		xout[13] = -(m2i + n2r);
 	}
 
 	// Inverse base transform for FFT size of 15
+	// same coefficient layout as FwdFFT_base15, the output is not scaled.
 	void FFT::InvFFT_base15(float * xin, float * xout)
 	{
-		int i, j;
-
-		xout[0] = xin[0] + (xin[1] + xin[2] + xin[3] + xin[4] + xin[5] + xin[6] + xin[7]) * 2;
-		for (i = 1; i<15; i++)
-		{
-			xout[i] = xin[0];
-			for (j = 1; j<8; j++)
-			{
-				xout[i] += xin[j] * wr_15[(i*j) % 15] * 2;
-				xout[i] += xin[15 - j] * wi_15[(i*j) % 15] * 2;
-			}
+		const float s3 = 0.8660254038f;   // sin(2*pi/3)
+		const float c51 = 0.3090169944f;  // cos(2*pi/5)
+		const float c52 = -0.8090169944f; // cos(4*pi/5)
+		const float s51 = 0.9510565163f;  // sin(2*pi/5)
+		const float s52 = 0.5877852523f;  // sin(4*pi/5)
+		float b0[5], b1r[5], b1i[5];
+		int n2;
+
+		// k1 = 0: X0, X6, conj(X3), X3, conj(X6). hermitian, so the 5 point transform is real.
+		float pr = 2.f * xin[6], pi = 2.f * xin[9];
+		float qr = 2.f * xin[3], qi = -2.f * xin[12];
+		b0[0] = xin[0] + pr + qr;
+		b0[1] = xin[0] + c51 * pr - s51 * pi + c52 * qr - s52 * qi;
+		b0[4] = xin[0] + c51 * pr + s51 * pi + c52 * qr + s52 * qi;
+		b0[2] = xin[0] + c52 * pr - s52 * pi + c51 * qr + s51 * qi;
+		b0[3] = xin[0] + c52 * pr + s52 * pi + c51 * qr - s51 * qi;
+
+		// k1 = 1: conj(X5), X1, X7, conj(X2), X4.
+		float z0r = xin[5], z0i = -xin[10];
+		float t1r = xin[1] + xin[4], t1i = xin[14] + xin[11];
+		float t2r = xin[7] + xin[2], t2i = xin[8] - xin[13];
+		float t3r = xin[1] - xin[4], t3i = xin[14] - xin[11];
+		float t4r = xin[7] - xin[2], t4i = xin[8] + xin[13];
+		float m1r = z0r + c51 * t1r + c52 * t2r, m1i = z0i + c51 * t1i + c52 * t2i;
+		float m2r = z0r + c52 * t1r + c51 * t2r, m2i = z0i + c52 * t1i + c51 * t2i;
+		float n1r = s51 * t3r + s52 * t4r, n1i = s51 * t3i + s52 * t4i;
+		float n2r = s52 * t3r - s51 * t4r, n2i = s52 * t3i - s51 * t4i;
+		b1r[0] = z0r + t1r + t2r;
+		b1i[0] = z0i + t1i + t2i;
+		b1r[1] = m1r - n1i;
+		b1i[1] = m1i + n1r;
+		b1r[4] = m1r + n1i;
+		b1i[4] = m1i - n1r;
+		b1r[2] = m2r - n2i;
+		b1i[2] = m2i + n2r;
+		b1r[3] = m2r + n2i;
+		b1i[3] = m2i - n2r;
+
+		// k1 = 2 is the conjugate of k1 = 1, so the 3 point transforms over k1 are real.
+		for (n2 = 0; n2 < 5; n2++){
+			xout[map_15[n2][0]] = b0[n2] + 2.f * b1r[n2];
+			xout[map_15[n2][1]] = b0[n2] - b1r[n2] - 2.f * s3 * b1i[n2];
+			xout[map_15[n2][2]] = b0[n2] - b1r[n2] + 2.f * s3 * b1i[n2];
 		}
 	}
 
@@ -105,9 +156,8 @@ namespace Beam{
 	This function supports two output coefficient orders - DFT_COEFF_ORDER_AEC and DFT_COEFF_ORDER_NRM.
 	For DFT_COEFF_ORDER_AEC, pfltOutData is FFTSize long, otherwise it is FFTSize+2 long.
 
-	pFltSinTable points to a FFTSize/4+1 long sin table which is necessary for ANSI C FFT function AecFwdFFT.
-	IntelIPP function does not use it. Application is responsible for providing corrent sintable to this function.
-	Please refer to filtbank.c for example.
+	The sin table, the permutation tables and the temp buffer come from the FFTPlan, which is built once
+	per FFTSize. See FFTPlan.h.
 
 	If FFTSize if power of 2 and DFT_COEFF_ORDER_AEC is specified, this function use in-place computation;
 	otherwise a temp buffer will be used internally, but you can still use same buffer for input and
@@ -115,11 +165,9 @@ namespace Beam{
 	different. Make sure your buffer is long enough if you want to use in-place computation. If input and output
 	buffers are different, the input buffer data will not be changed.
 
-	Input:  pXformInfo:  AEC transform structure information
+	Input:  plan:  tables and scratch buffers for FFTSize
 	xin:  Pointer of real time sequence in normal order x[0], x[1], ... , x[FFTSize-1];
-	sin_table:  sin table containing values of sin(2*pi*(0:FFTSize/4)/FFTSize). The size
-	of table is FFTSize/4+1;
-	FFTSize:  length of time sequence, FFTSize must 2^n, 5*2^n, or 15*2^n
+	FFTSize:  length of time sequence, plan.size(), FFTSize must 2^n, 5*2^n, or 15*2^n
 	fCoeffOrder: DFT_COEFF_ORDER_AEC or DFT_COEFF_ORDER_NRM
 
 	Output: xout:  Pointer of complex frequency sequence, only  0 - FFTSize/2 complex samples
@@ -137,7 +185,7 @@ namespace Beam{
 
 	Qin Li, Feb 18, 2005
 	***************************************************************************/
-	void FFT::AecCcsFwdFFT(float * xin, float * xout, bool coeffOrder){
+	void FFT::AecCcsFwdFFT(FFTPlan& plan, float * xin, float * xout, bool coeffOrder, const float * window){
 		// sin and cos table for base 5 FFT
 		const float wr1 = 0.309016994374947f;  // cos(2pi/5)
 		const float wr2 = -0.809016994374947f;  // cos(4pi/5)
@@ -147,61 +195,58 @@ namespace Beam{
 		const float wi2 = -0.587785252292473f;  // -sin(4pi/5)
 		const float wi3 = 0.587785252292473f;  // -sin(6pi/5)
 		const float wi4 = 0.951056516295154f;  // -sin(4pi/5)
-		float tempbuf[4 * FRAME_SIZE];
-		float sin_tab[FRAME_SIZE / 2 + 1];
-		unsigned int FFTSize = FRAME_SIZE * 2;
-		for (unsigned int i = 0; i <= FRAME_SIZE / 2; i++) {
-			sin_tab[i] = (float)sinf(2.0f * (float)PI * i / FFTSize);
-		}
-		unsigned int base, step, N_base;
-		unsigned int i, j, k;   // loop indices
-		float * cos_tab, *x;
+		unsigned int FFTSize = (unsigned int)plan.size();
+		unsigned int base = (unsigned int)plan.base();
+		float * tempbuf = plan.work();
+		unsigned int step, stage;
+		unsigned int i, j;   // loop indices
+		float * x;
 
-		if (xin != xout)
-		{
-//			memcpy_s(xout, FFTSize*sizeof(float), xin, FFTSize*sizeof(float));
-			memcpy(xout, xin, FFTSize*sizeof(float));
-		}
 		x = xout;
-
-		cos_tab = sin_tab + FFTSize / 4;
-
-		if ((FFTSize & (-(int)FFTSize)) == FFTSize) // detect if FFTSize is power of 2
+		if (xin != xout)
 		{
-			base = 4;
-		}
-		else{
-			if (FFTSize % 15)
-				base = 5;
+			// out-of-place: reorder and window in the pass that copies the input.
+			const unsigned int * input_order = plan.input_order();
+			float * dst = base == 4 ? x : tempbuf;
+			if (window)
+			{
+				for (i = 0; i < FFTSize; i++)
+				{
+					dst[i] = xin[input_order[i]] * window[input_order[i]];
+				}
+			}
 			else
-				base = 15;
+			{
+				for (i = 0; i < FFTSize; i++)
+				{
+					dst[i] = xin[input_order[i]];
+				}
+			}
 		}
-		N_base = FFTSize / base;  //number of base transforms
-
-		// bit reversal
-		if (base == 4)  // FFTSize is power of 2
+		else
 		{
-			for (i = 0, j = 0; i < FFTSize; i++)
+			if (window)
 			{
-				if (j>i)
+				for (i = 0; i < FFTSize; i++)
 				{
-					float temp;
-					temp = x[j];
-					x[j] = x[i];
-					x[i] = temp;
+					x[i] *= window[i];
 				}
-				k = FFTSize / 2;
-				while (k >= 2 && j >= k)
+			}
+			// bit reversal, using the permutation tables of the plan
+			if (base == 4)  // FFTSize is power of 2
+			{
+				const unsigned int * swap_first = plan.swap_first();
+				const unsigned int * swap_second = plan.swap_second();
+				int num_swaps = plan.num_swaps();
+				for (int s = 0; s < num_swaps; s++)
 				{
-					j -= k;
-					k >>= 1;
+					float temp;
+					temp = x[swap_second[s]];
+					x[swap_second[s]] = x[swap_first[s]];
+					x[swap_first[s]] = temp;
 				}
-				j += k;
 			}
-		}
-		else{
-			if (base == 5)
-			{
+			else{
 				/***********************************************************************
 				cannot do in-place indexing.The basic idea is to do bit inverse
 				for lower bits corresponding to N_base. The higest bits corresponding
@@ -231,118 +276,10 @@ namespace Beam{
 				18  (10010)                 15  (01111)
 				19  (10011)                 19  (10011)
 				***********************************************************************/
-				if (base*(N_base - 1) + 4 >= FFTSize)
-					return;
-
-				for (i = 0, j = 0; i < N_base && j < N_base; i++)
-				{
-					if (j == i)  //just copy, no bit reverse
-					{
-						unsigned int utemp;
-						utemp = i*base;
-						tempbuf[utemp] = x[i];
-						tempbuf[utemp + 1] = x[N_base + i];
-						tempbuf[utemp + 2] = x[N_base * 2 + i];
-						tempbuf[utemp + 3] = x[N_base * 3 + i];
-						tempbuf[utemp + 4] = x[N_base * 4 + i];
-					}
-					if (j > i)  // bit reverse and copy
-					{
-						unsigned int utemp;
-						utemp = j*base;
-						tempbuf[utemp] = x[i];
-						tempbuf[utemp + 1] = x[N_base + i];
-						tempbuf[utemp + 2] = x[N_base * 2 + i];
-						tempbuf[utemp + 3] = x[N_base * 3 + i];
-						tempbuf[utemp + 4] = x[N_base * 4 + i];
-
-						utemp = i*base;
-						tempbuf[utemp] = x[j];
-						tempbuf[utemp + 1] = x[N_base + j];
-						tempbuf[utemp + 2] = x[N_base * 2 + j];
-						tempbuf[utemp + 3] = x[N_base * 3 + j];
-						tempbuf[utemp + 4] = x[N_base * 4 + j];
-					}
-					k = N_base / 2;
-					while (k >= 2 && j >= k)
-					{
-						j -= k;
-						k >>= 1;
-					}
-					j += k;
-				}
-			}
-			else{  // base == 15
-
-				if (base*(N_base - 1) + 14 >= FFTSize)
-					return;
-
-				for (i = 0, j = 0; i < N_base && j < N_base; i++)
+				const unsigned int * permutation = plan.permutation();
+				for (i = 0; i < FFTSize; i++)
 				{
-					if (j == i)  //just copy, no bit reverse
-					{
-						unsigned int utemp;
-						utemp = i*base;
-						tempbuf[utemp] = x[i];
-						tempbuf[utemp + 1] = x[N_base + i];
-						tempbuf[utemp + 2] = x[N_base * 2 + i];
-						tempbuf[utemp + 3] = x[N_base * 3 + i];
-						tempbuf[utemp + 4] = x[N_base * 4 + i];
-						tempbuf[utemp + 5] = x[N_base * 5 + i];
-						tempbuf[utemp + 6] = x[N_base * 6 + i];
-						tempbuf[utemp + 7] = x[N_base * 7 + i];
-						tempbuf[utemp + 8] = x[N_base * 8 + i];
-						tempbuf[utemp + 9] = x[N_base * 9 + i];
-						tempbuf[utemp + 10] = x[N_base * 10 + i];
-						tempbuf[utemp + 11] = x[N_base * 11 + i];
-						tempbuf[utemp + 12] = x[N_base * 12 + i];
-						tempbuf[utemp + 13] = x[N_base * 13 + i];
-						tempbuf[utemp + 14] = x[N_base * 14 + i];
-					}
-					if (j > i)  // bit reverse and copy
-					{
-						unsigned int utemp;
-						utemp = j*base;
-						tempbuf[utemp] = x[i];
-						tempbuf[utemp + 1] = x[N_base + i];
-						tempbuf[utemp + 2] = x[N_base * 2 + i];
-						tempbuf[utemp + 3] = x[N_base * 3 + i];
-						tempbuf[utemp + 4] = x[N_base * 4 + i];
-						tempbuf[utemp + 5] = x[N_base * 5 + i];
-						tempbuf[utemp + 6] = x[N_base * 6 + i];
-						tempbuf[utemp + 7] = x[N_base * 7 + i];
-						tempbuf[utemp + 8] = x[N_base * 8 + i];
-						tempbuf[utemp + 9] = x[N_base * 9 + i];
-						tempbuf[utemp + 10] = x[N_base * 10 + i];
-						tempbuf[utemp + 11] = x[N_base * 11 + i];
-						tempbuf[utemp + 12] = x[N_base * 12 + i];
-						tempbuf[utemp + 13] = x[N_base * 13 + i];
-						tempbuf[utemp + 14] = x[N_base * 14 + i];
-
-						utemp = i*base;
-						tempbuf[utemp] = x[j];
-						tempbuf[utemp + 1] = x[N_base + j];
-						tempbuf[utemp + 2] = x[N_base * 2 + j];
-						tempbuf[utemp + 3] = x[N_base * 3 + j];
-						tempbuf[utemp + 4] = x[N_base * 4 + j];
-						tempbuf[utemp + 5] = x[N_base * 5 + j];
-						tempbuf[utemp + 6] = x[N_base * 6 + j];
-						tempbuf[utemp + 7] = x[N_base * 7 + j];
-						tempbuf[utemp + 8] = x[N_base * 8 + j];
-						tempbuf[utemp + 9] = x[N_base * 9 + j];
-						tempbuf[utemp + 10] = x[N_base * 10 + j];
-						tempbuf[utemp + 11] = x[N_base * 11 + j];
-						tempbuf[utemp + 12] = x[N_base * 12 + j];
-						tempbuf[utemp + 13] = x[N_base * 13 + j];
-						tempbuf[utemp + 14] = x[N_base * 14 + j];
-					}
-					k = N_base / 2;
-					while (k >= 2 && j >= k)
-					{
-						j -= k;
-						k >>= 1;
-					}
-					j += k;
+					tempbuf[i] = x[permutation[i]];
 				}
 			}
 		}
@@ -412,8 +349,13 @@ namespace Beam{
 
 		// now we can do in-place butterfly calculation
 		step = base;
+		stage = 0;
 		while (step<FFTSize)
 		{
+			const float * tw_cos = plan.twiddle_cos(stage);
+			const float * tw_sin = plan.twiddle_sin(stage);
+			// the SIMD kernels need blocks of at least 4 butterflies.
+			FFTButterflyKernel kernel = (step + 1) / 2 > 4 ? plan.fwd_kernel() : NULL;
 			// INT note:  the following nested loops can be straighten to a single loop, with
 			// if statement in the loop. Need to test which way is faster.
 			for (i = 0; i<FFTSize; i += (step * 2))
@@ -436,19 +378,21 @@ namespace Beam{
 					x[i + step + step / 2] = -x[i + step + step / 2];
 
 				// other butterfly. both inputs and outputs are complex
-				for (j = 1; j<(step + 1) / 2; j++)
+				// the SIMD kernel computes the first ones, the scalar code the rest.
+				j = kernel != NULL ? kernel(x + i, step, tw_cos, tw_sin) : 1;
+				for (; j<(step + 1) / 2; j++)
 				{
 					float wr, wi, tempr, tempi;
-					int r, pr, pi, qr, qi;
+					int pr, pi, qr, qi;
 
 					pr = i + j;
 					pi = i + step - j;
 					qr = pr + step;
 					qi = pi + step;
-					r = j*N_base / 2;      // power of W  (0 <= r <= FFTSize/4)
 
-					wr = cos_tab[-r];
-					wi = -sin_tab[r];
+					// power of W is j*N_base/2, precomputed in the plan
+					wr = tw_cos[j];
+					wi = -tw_sin[j];
 
 					/**************************************************************************
 					butterfly computation. this is more complicated than complex butterfly
@@ -495,7 +439,7 @@ namespace Beam{
 			} // outer loop
 
 			step *= 2;
-			N_base /= 2;     // N_base*step = FFT_SIZE
+			stage++;
 
 		} // while loop
 
@@ -515,6 +459,322 @@ namespace Beam{
 		}
 	}
 
+	/***************************************************************************
+	Function name: AecCcsFwdFFTBatch
+
+	Decription:
+	Forward FFT of plan.channels() real sequences at once. The algorithm is the one of AecCcsFwdFFT
+	with DFT_COEFF_ORDER_AEC, but every value is a group of plan.channels() floats, one per channel,
+	so the inner loops run over the channels and the compiler can map them to SIMD lanes. The twiddles
+	are loaded once per butterfly and shared by all channels.
+
+	Input:  plan:  tables and scratch buffers for FFTSize and the number of channels
+	xin:  channel-interleaved real time sequences, xin[n * channels + c] is x[n] of channel c
+
+	Output: xout:  channel-interleaved spectra in DFT_COEFF_ORDER_AEC, xout[k * channels + c]
+	is entry k of the AecCcsFwdFFT output of channel c. Input and output buffers can be same.
+	***************************************************************************/
+	void FFT::AecCcsFwdFFTBatch(FFTPlan& plan, float * xin, float * xout){
+		// sin and cos table for base 5 FFT, see AecCcsFwdFFT
+		const float wr1 = 0.309016994374947f;  // cos(2pi/5)
+		const float wr2 = -0.809016994374947f;  // cos(4pi/5)
+		const float wr3 = -0.809016994374947f;  // cos(6pi/5)
+		const float wr4 = 0.309016994374947f;  // cos(8pi/5)
+		const float wi1 = -0.951056516295154f;  // -sin(2pi/5) 
+		const float wi2 = -0.587785252292473f;  // -sin(4pi/5)
+		const float wi3 = 0.587785252292473f;  // -sin(6pi/5)
+		const float wi4 = 0.951056516295154f;  // -sin(4pi/5)
+		unsigned int FFTSize = (unsigned int)plan.size();
+		unsigned int base = (unsigned int)plan.base();
+		unsigned int C = (unsigned int)plan.channels();
+		float * tempbuf = plan.work();
+		unsigned int step, stage;
+		unsigned int i, j, c;   // loop indices
+		float * x;
+
+		if (xin != xout)
+		{
+			memcpy(xout, xin, FFTSize*C*sizeof(float));
+		}
+		x = xout;
+
+		// bit reversal, swapping or gathering whole groups of channels
+		if (base == 4)
+		{
+			const unsigned int * swap_first = plan.swap_first();
+			const unsigned int * swap_second = plan.swap_second();
+			int num_swaps = plan.num_swaps();
+			for (int s = 0; s < num_swaps; s++)
+			{
+				float * a = x + swap_first[s] * C;
+				float * b = x + swap_second[s] * C;
+				for (c = 0; c < C; c++)
+				{
+					float temp = b[c];
+					b[c] = a[c];
+					a[c] = temp;
+				}
+			}
+		}
+		else{
+			const unsigned int * permutation = plan.permutation();
+			for (i = 0; i < FFTSize; i++)
+			{
+				memcpy(tempbuf + i * C, x + permutation[i] * C, C*sizeof(float));
+			}
+		}
+
+		// base transform 4, 5 or 15
+		if (base == 4)
+		{
+			for (i = 0; i < FFTSize; i += 4)
+			{
+				float * x0 = x + i * C;
+				float * x1 = x0 + C;
+				float * x2 = x1 + C;
+				float * x3 = x2 + C;
+				c = 0;
+#ifdef BEAM_BATCH_SSE
+				for (; c + 4 <= C; c += 4)
+				{
+					__m128 y0 = _mm_loadu_ps(x0 + c);
+					__m128 y1 = _mm_loadu_ps(x1 + c);
+					__m128 y2 = _mm_loadu_ps(x2 + c);
+					__m128 y3 = _mm_loadu_ps(x3 + c);
+					_mm_storeu_ps(x0 + c, _mm_add_ps(_mm_add_ps(_mm_add_ps(y0, y2), y1), y3));
+					_mm_storeu_ps(x2 + c, _mm_sub_ps(_mm_add_ps(_mm_sub_ps(y0, y2), y1), y3));
+					_mm_storeu_ps(x1 + c, _mm_sub_ps(y0, y1));
+					_mm_storeu_ps(x3 + c, _mm_sub_ps(y3, y2));
+				}
+#endif
+				for (; c < C; c++)
+				{
+					float temp1, temp2;
+					temp1 = x0[c] + x2[c] + x1[c] + x3[c];
+					temp2 = x0[c] - x2[c] + x1[c] - x3[c];
+					x1[c] = x0[c] - x1[c];
+					x3[c] = x3[c] - x2[c];
+					x0[c] = temp1;
+					x2[c] = temp2;
+				}
+			}
+		}
+		else if (base == 5)
+		{
+			for (i = 0; i + 4 < FFTSize; i += 5)
+			{
+				const float * t = tempbuf + i * C;
+				float * y = x + i * C;
+				for (c = 0; c < C; c++)
+				{
+					float t0 = t[c], t1 = t[C + c], t2 = t[2 * C + c], t3 = t[3 * C + c], t4 = t[4 * C + c];
+					y[c] = t0 + t1 + t2 + t3 + t4;
+					y[C + c] = t0 + t1 * wr1 + t2 * wr2 + t3 * wr3 + t4 * wr4;
+					y[4 * C + c] = +t1 * wi1 + t2 * wi2 + t3 * wi3 + t4 * wi4;
+					y[2 * C + c] = t0 + t1 * wr2 + t2 * wr4 + t3 * wr1 + t4 * wr3;
+					y[3 * C + c] = +t1 * wi2 + t2 * wi4 + t3 * wi1 + t4 * wi3;
+				}
+			}
+		}
+		else{
+			// the base 15 transform is rare, so it de-interleaves one channel at a time.
+			float in[15], out[15];
+			for (i = 0; i + 14 < FFTSize; i += 15)
+			{
+				for (c = 0; c < C; c++)
+				{
+					for (j = 0; j < 15; j++)
+						in[j] = tempbuf[(i + j) * C + c];
+					FwdFFT_base15(in, out);
+					for (j = 0; j < 15; j++)
+						x[(i + j) * C + c] = out[j];
+				}
+			}
+		}
+
+		// in-place butterflies, see AecCcsFwdFFT for the memory layout
+		step = base;
+		stage = 0;
+		while (step<FFTSize)
+		{
+			const float * tw_cos = plan.twiddle_cos(stage);
+			const float * tw_sin = plan.twiddle_sin(stage);
+			for (i = 0; i<FFTSize; i += (step * 2))
+			{
+				float * xp = x + i * C;
+				float * xq = x + (i + step) * C;
+
+				// first butterfly
+				for (c = 0; c < C; c++)
+				{
+					float temp = xp[c] - xq[c];
+					xp[c] += xq[c];
+					xq[c] = temp;
+				}
+
+				// last butterfly
+				if (step % 2 == 0)
+				{
+					float * xl = x + (i + step + step / 2) * C;
+					for (c = 0; c < C; c++)
+						xl[c] = -xl[c];
+				}
+
+				// other butterflies
+				for (j = 1; j<(step + 1) / 2; j++)
+				{
+					float wr = tw_cos[j];
+					float wi = -tw_sin[j];
+					float * xpr = x + (i + j) * C;
+					float * xpi = x + (i + step - j) * C;
+					float * xqr = xpr + step * C;
+					float * xqi = xpi + step * C;
+					c = 0;
+#ifdef BEAM_BATCH_SSE
+					__m128 vwr = _mm_set1_ps(wr);
+					__m128 vwi = _mm_set1_ps(wi);
+					for (; c + 4 <= C; c += 4)
+					{
+						__m128 pr = _mm_loadu_ps(xpr + c);
+						__m128 pi = _mm_loadu_ps(xpi + c);
+						__m128 qr = _mm_loadu_ps(xqr + c);
+						__m128 qi = _mm_loadu_ps(xqi + c);
+						__m128 tempr = _mm_sub_ps(_mm_mul_ps(qr, vwr), _mm_mul_ps(qi, vwi));
+						__m128 tempi = _mm_add_ps(_mm_mul_ps(qr, vwi), _mm_mul_ps(qi, vwr));
+						_mm_storeu_ps(xqi + c, _mm_add_ps(pi, tempi));
+						_mm_storeu_ps(xqr + c, _mm_sub_ps(tempi, pi));
+						_mm_storeu_ps(xpi + c, _mm_sub_ps(pr, tempr));
+						_mm_storeu_ps(xpr + c, _mm_add_ps(pr, tempr));
+					}
+#endif
+					for (; c < C; c++)
+					{
+						float tempr = xqr[c] * wr - xqi[c] * wi;
+						float tempi = xqr[c] * wi + xqi[c] * wr;
+						xqi[c] = xpi[c] + tempi;
+						xqr[c] = -xpi[c] + tempi;
+						xpi[c] = xpr[c] - tempr;
+						xpr[c] += tempr;
+					}
+				}
+			}
+			step *= 2;
+			stage++;
+		}
+	}
+
+	/***************************************************************************
+	Function name: AecCcsFwdFFTPacked
+
+	Decription:
+	Same result as AecCcsFwdFFTBatch, but channel 2p and 2p+1 are packed into the real and imaginary
+	parts of one complex sequence z[n] = x2p[n] + i * x2p+1[n]. Because the input is channel-interleaved,
+	the packed sequences are already in place and one complex transform of FFTSize points serves two
+	channels. The spectra are separated afterwards using the symmetry of the transform of a real sequence:
+
+	X2p[k]   = (Z[k] + conj(Z[FFTSize-k])) / 2
+	X2p+1[k] = (Z[k] - conj(Z[FFTSize-k])) / 2i
+
+	The complex transform is an in-place radix-2 decimation-in-time FFT with the tables of the plan.
+	It needs plan.can_pack(): FFTSize is a power of 2 and the number of channels is even.
+
+	Input:  plan:  tables and scratch buffers for FFTSize and the number of channels
+	xin:  channel-interleaved real time sequences, xin[n * channels + c] is x[n] of channel c
+
+	Output: xout:  channel-interleaved spectra in DFT_COEFF_ORDER_AEC, same as AecCcsFwdFFTBatch.
+	Input and output buffers can be same.
+	***************************************************************************/
+	void FFT::AecCcsFwdFFTPacked(FFTPlan& plan, float * xin, float * xout){
+		unsigned int FFTSize = (unsigned int)plan.size();
+		unsigned int C = (unsigned int)plan.channels();
+		const float * tw_cos = plan.complex_twiddle_cos();
+		const float * tw_sin = plan.complex_twiddle_sin();
+		float * z = plan.work();
+		unsigned int i, j, k, c, len, half, stride;
+
+		memcpy(z, xin, FFTSize*C*sizeof(float));
+
+		// bit reversal of the complex samples
+		const unsigned int * swap_first = plan.complex_swap_first();
+		const unsigned int * swap_second = plan.complex_swap_second();
+		int num_swaps = plan.num_complex_swaps();
+		for (int s = 0; s < num_swaps; s++)
+		{
+			float * a = z + swap_first[s] * C;
+			float * b = z + swap_second[s] * C;
+			for (c = 0; c < C; c++)
+			{
+				float temp = b[c];
+				b[c] = a[c];
+				a[c] = temp;
+			}
+		}
+
+		// butterflies: Z[p] = Z[p] + W * Z[q], Z[q] = Z[p] - W * Z[q]
+		for (len = 2, stride = FFTSize / 2; len <= FFTSize; len *= 2, stride /= 2)
+		{
+			half = len / 2;
+			for (i = 0; i < FFTSize; i += len)
+			{
+				for (j = 0; j < half; j++)
+				{
+					float wr = tw_cos[j * stride];
+					float wi = tw_sin[j * stride];
+					float * zp = z + (i + j) * C;
+					float * zq = z + (i + j + half) * C;
+					c = 0;
+#ifdef BEAM_BATCH_SSE
+					// two packed pairs per vector: re, im, re, im
+					__m128 vwr = _mm_set1_ps(wr);
+					__m128 vwi = _mm_setr_ps(-wi, wi, -wi, wi);
+					for (; c + 4 <= C; c += 4)
+					{
+						__m128 p = _mm_loadu_ps(zp + c);
+						__m128 q = _mm_loadu_ps(zq + c);
+						__m128 qs = _mm_shuffle_ps(q, q, _MM_SHUFFLE(2, 3, 0, 1));
+						__m128 t = _mm_add_ps(_mm_mul_ps(q, vwr), _mm_mul_ps(qs, vwi));
+						_mm_storeu_ps(zp + c, _mm_add_ps(p, t));
+						_mm_storeu_ps(zq + c, _mm_sub_ps(p, t));
+					}
+#endif
+					for (; c < C; c += 2)
+					{
+						float tr = zq[c] * wr - zq[c + 1] * wi;
+						float ti = zq[c] * wi + zq[c + 1] * wr;
+						zq[c] = zp[c] - tr;
+						zq[c + 1] = zp[c + 1] - ti;
+						zp[c] += tr;
+						zp[c + 1] += ti;
+					}
+				}
+			}
+		}
+
+		// separate the spectra of the two channels of each pair
+		for (c = 0; c < C; c += 2)
+		{
+			xout[c] = z[c];
+			xout[c + 1] = z[c + 1];
+			xout[FFTSize / 2 * C + c] = z[FFTSize / 2 * C + c];
+			xout[FFTSize / 2 * C + c + 1] = z[FFTSize / 2 * C + c + 1];
+		}
+		for (k = 1; k < FFTSize / 2; k++)
+		{
+			const float * zk = z + k * C;
+			const float * zm = z + (FFTSize - k) * C;
+			float * re = xout + k * C;
+			float * im = xout + (FFTSize - k) * C;
+			for (c = 0; c < C; c += 2)
+			{
+				float zr = zk[c], zi = zk[c + 1], mr = zm[c], mi = zm[c + 1];
+				re[c] = 0.5f * (zr + mr);
+				im[c] = 0.5f * (zi - mi);
+				re[c + 1] = 0.5f * (zi + mi);
+				im[c + 1] = 0.5f * (mr - zr);
+			}
+		}
+	}
+
 	/***************************************************************************
 	Function name: AecCcsInvFFT  - CCS Inverse FFT.
 
@@ -522,21 +782,18 @@ namespace Beam{
 	This function supports two output coefficient orders - DFT_COEFF_ORDER_AEC and DFT_COEFF_ORDER_NRM.
 	For DFT_COEFF_ORDER_AEC, pfltInData is FFTSize long, otherwise it is FFTSize+2 long.
 
-	pFltSinTable points to a FFTSize/4+1 long sin table which is necessary for ANSI C FFT function AecInvFFT.
-	IntelIPP function does not use it. Application is responsible for providing corrent sintable to this function.
-	Please refer to filtbank.c for example.
+	The sin table, the permutation tables and the temp buffer come from the FFTPlan, which is built once
+	per FFTSize. See FFTPlan.h.
 
 	If FFTSize if power of 2 and DFT_COEFF_ORDER_AEC is specified, this function use in-place computation;
 	otherwise a temp buffer will be used internally, but you can still use same buffer for input and
 	output sequences. If input and output buffers are different, the input buffer data will not be changed.
 
-	Input:  pXformInfo:  AEC transform structure information
+	Input:  plan:  tables and scratch buffers for FFTSize
 	x:  Pointer of complex frequency sequence, only  0 - FFTSize/2 complex samples
 	are saved as:
 	X[0], Xr[1], Xr[2], ..., Xr[FFTSize/2-1], X[FFTSize/2], Xi[FFTSize/2-1], ..., Xi[2], Xi[1];
-	sin_table:  sin table containing values of sin(2*pi*(0:FFTSize/4)/FFTSize). The size
-	of table is FFTSize/4+1;
-	FFTSize:  length of time sequence, FFTSize must 2^n, 5*2^n, or 15*2^n
+	FFTSize:  length of time sequence, plan.size(), FFTSize must 2^n, 5*2^n, or 15*2^n
 	fCoeffOrder: DFT_COEFF_ORDER_AEC or DFT_COEFF_ORDER_NRM
 
 	Output: x:  Pointer of real time sequence in normal order x[0], x[1], ... , x[FFTSize-1];
@@ -554,7 +811,9 @@ namespace Beam{
 
 	Qin Li, Feb 18, 2005
 	***************************************************************************/
-	void FFT::AecCcsInvFFT(float * xin, float * xout, bool coeffOrder) {
+	// Everything of AecCcsInvFFT but the final reordering. The result is left in bit-reversed order,
+	// in xout for power of 2 sizes and in plan.work() otherwise.
+	void FFT::InvFFTCore(FFTPlan& plan, float * xin, float * xout, bool coeffOrder) {
 
 		// sin and cos table for base 5 FFT
 		const float wr1 = 0.309016994374947f;  // cos(2pi/5)
@@ -565,22 +824,19 @@ namespace Beam{
 		const float wi2 = 0.587785252292473f;  // sin(4pi/5)
 		const float wi3 = -0.587785252292473f;  // sin(6pi/5)
 		const float wi4 = -0.951056516295154f;  // sin(8pi/5)
-		float tempbuf[4 * FRAME_SIZE];
-		float sin_tab[FRAME_SIZE / 2 + 1];
-		unsigned int FFTSize = 2 * FRAME_SIZE;
-		for (unsigned int i = 0; i <= FFTSize / 4; i++) {
-			sin_tab[i] = sinf(2.0f * (float)PI * i / FFTSize);
-		}
-		unsigned int base, step, N_base;
-		unsigned int i, j, k;   // loop indices
-		float *cos_tab, *x, *pfTemp;
-		cos_tab = sin_tab + FFTSize / 4;
+		unsigned int FFTSize = (unsigned int)plan.size();
+		unsigned int base = (unsigned int)plan.base();
+		float * tempbuf = plan.work();
+		unsigned int step;
+		int stage;
+		unsigned int i, j;   // loop indices
+		float *x, *pfTemp;
 		if (coeffOrder)
 		{
 			if (xin != xout)
 			{
 //				memcpy_s(xout, FFTSize*sizeof(float), xin, FFTSize*sizeof(float));
-				memcpy(xout, tempbuf, (FFTSize + 2)*sizeof(float));
+				memcpy(xout, xin, FFTSize*sizeof(float));
 			}
 			x = xout;
 		}
@@ -606,25 +862,17 @@ namespace Beam{
 			x = xout;
 		}
 
-		if ((FFTSize & (-(int)FFTSize)) == FFTSize) // detect if FFTSize is power of 2
-		{
-			base = 4;
-		}
-		else{
-			if (FFTSize % 15)
-				base = 5;
-			else
-				base = 15;
-		}
-		N_base = FFTSize / base;  //number of base transforms
-
 		// Perform butterfly calculation until reach base transform 4 or 5;
 		step = FFTSize;
-		N_base = 1;
+		stage = plan.num_stages();
 		while (step > base)
 		{
 			step /= 2;
-			N_base *= 2;    // N_base*step = FFT_SIZE
+			stage--;
+			const float * tw_cos = plan.twiddle_cos(stage);
+			const float * tw_sin = plan.twiddle_sin(stage);
+			// the SIMD kernels need blocks of at least 4 butterflies.
+			FFTButterflyKernel kernel = (step + 1) / 2 > 4 ? plan.inv_kernel() : NULL;
 			for (i = 0; i<FFTSize; i += step * 2)
 			{
 				float temp;
@@ -644,19 +892,21 @@ namespace Beam{
 				}
 
 				// other butterfly. both inputs and outputs are complex
-				for (j = 1; j<(step + 1) / 2; j++)
+				// the SIMD kernel computes the first ones, the scalar code the rest.
+				j = kernel != NULL ? kernel(x + i, step, tw_cos, tw_sin) : 1;
+				for (; j<(step + 1) / 2; j++)
 				{
-					int r, pr, pi, qr, qi;
+					int pr, pi, qr, qi;
 					float wr, wi, tempr, tempi;
 
 					pr = i + j;
 					pi = i + step - j;
 					qr = pr + step;
 					qi = pi + step;
-					r = j*N_base / 2;      // power of W  (0 <= r <= FFTSize/4)
 
-					wr = cos_tab[-r];
-					wi = sin_tab[r];   // this if for inverse tansform. Take negation for 
+					// power of W is j*N_base/2, precomputed in the plan
+					wr = tw_cos[j];
+					wi = tw_sin[j];   // this if for inverse tansform. Take negation for 
 					// forward transform.
 
 					/**************************************************************************
@@ -764,170 +1014,93 @@ namespace Beam{
 					InvFFT_base15(x + i, tempbuf + i);
 			}
 		}
+	}
+
+	void FFT::AecCcsInvFFT(FFTPlan& plan, float * xin, float * xout, bool coeffOrder) {
+		unsigned int FFTSize = (unsigned int)plan.size();
+		unsigned int base = (unsigned int)plan.base();
+		float * tempbuf = plan.work();
+		float * x = xout;
+		unsigned int i;
+
+		InvFFTCore(plan, xin, xout, coeffOrder);
 
 		// convert bit-reversed order to normal order
 		if (base == 4)  // FFTSize is power of 2
 		{
-			for (i = 0, j = 0; i < FFTSize; i++)
+			const unsigned int * swap_first = plan.swap_first();
+			const unsigned int * swap_second = plan.swap_second();
+			int num_swaps = plan.num_swaps();
+			for (int s = 0; s < num_swaps; s++)
 			{
-				if (j>i)
-				{
-					float temp;
-					temp = x[j];
-					x[j] = x[i];
-					x[i] = temp;
-				}
-				k = FFTSize / 2;
-				while (k >= 2 && j >= k)
-				{
-					j -= k;
-					k >>= 1;
-				}
-				j += k;
+				float temp;
+				temp = x[swap_second[s]];
+				x[swap_second[s]] = x[swap_first[s]];
+				x[swap_first[s]] = temp;
 			}
 		}
 		else{
-			if (base == 5)
+			/***********************************************************************
+			This is just the inverse process of the bit reversal in the forward fft function.
+
+			For example, for FFT of size 20:
+			bit-reversed order              normal order
+			0   (00000)                   0   (00000)
+			4   (00100)                   1   (00001)
+			8   (01000)                   2   (00010)
+			12  (01100)                   3   (00011)
+			16  (10000)                   4   (00100)
+			2   (00010)                   5   (00101)
+			6   (00110)                   6   (00110)
+			10  (01010)                   7   (00111)
+			14  (01110)                   8   (01000)
+			18  (10010)                   9   (01001)
+			1   (00001)                   10  (01010)
+			5   (00101)                   11  (01011)
+			9   (01001)                   12  (01100)
+			13  (01101)                   13  (01101)
+			17  (10001)                   14  (01110)
+			3   (00011)                   15  (01111)
+			7   (00111)                   16  (10000)
+			11  (01011)                   17  (10001)
+			15  (01111)                   18  (10010)
+			19  (10011)                   19  (10011)
+			***********************************************************************/
+			const unsigned int * permutation = plan.permutation();
+			for (i = 0; i < FFTSize; i++)
 			{
-				/***********************************************************************
-				This is just the inverse process of the bit reversal in the forward fft function.
-
-				For example, for FFT of size 20:
-				bit-reversed order              normal order
-				0   (00000)                   0   (00000)
-				4   (00100)                   1   (00001)
-				8   (01000)                   2   (00010)
-				12  (01100)                   3   (00011)
-				16  (10000)                   4   (00100)
-				2   (00010)                   5   (00101)
-				6   (00110)                   6   (00110)
-				10  (01010)                   7   (00111)
-				14  (01110)                   8   (01000)
-				18  (10010)                   9   (01001)
-				1   (00001)                   10  (01010)
-				5   (00101)                   11  (01011)
-				9   (01001)                   12  (01100)
-				13  (01101)                   13  (01101)
-				17  (10001)                   14  (01110)
-				3   (00011)                   15  (01111)
-				7   (00111)                   16  (10000)
-				11  (01011)                   17  (10001)
-				15  (01111)                   18  (10010)
-				19  (10011)                   19  (10011)
-				***********************************************************************/
-				if (base*(N_base - 1) + 4 >= FFTSize)
-					return;
-
-				for (i = 0, j = 0; i < N_base && j < N_base; i++)
-				{
-					if (j == i)  //just copy, no bit reverse
-					{
-						unsigned int utemp;
-						utemp = i*base;
-						x[i] = tempbuf[utemp];
-						x[N_base + i] = tempbuf[utemp + 1];
-						x[N_base * 2 + i] = tempbuf[utemp + 2];
-						x[N_base * 3 + i] = tempbuf[utemp + 3];
-						x[N_base * 4 + i] = tempbuf[utemp + 4];
-					}
-					if (j > i)  // bit reverse and copy
-					{
-						unsigned int utemp;
-						utemp = j*base;
-						x[i] = tempbuf[utemp];
-						x[N_base + i] = tempbuf[utemp + 1];
-						x[N_base * 2 + i] = tempbuf[utemp + 2];
-						x[N_base * 3 + i] = tempbuf[utemp + 3];
-						x[N_base * 4 + i] = tempbuf[utemp + 4];
-
-						utemp = i*base;
-						x[j] = tempbuf[utemp];
-						x[N_base + j] = tempbuf[utemp + 1];
-						x[N_base * 2 + j] = tempbuf[utemp + 2];
-						x[N_base * 3 + j] = tempbuf[utemp + 3];
-						x[N_base * 4 + j] = tempbuf[utemp + 4];
-					}
-					k = N_base / 2;
-					while (k >= 2 && j >= k)
-					{
-						j -= k;
-						k >>= 1;
-					}
-					j += k;
-				}
+				x[permutation[i]] = tempbuf[i];
 			}
-			else{  // base = 15
-
-				if (base*(N_base - 1) + 14 >= FFTSize)
-					return;
+		}
+	}
 
-				for (i = 0, j = 0; i < N_base && j < N_base; i++)
-				{
-					if (j == i)  //just copy, no bit reverse
-					{
-						unsigned int utemp;
-						utemp = i*base;
-						x[i] = tempbuf[utemp];
-						x[N_base + i] = tempbuf[utemp + 1];
-						x[N_base * 2 + i] = tempbuf[utemp + 2];
-						x[N_base * 3 + i] = tempbuf[utemp + 3];
-						x[N_base * 4 + i] = tempbuf[utemp + 4];
-						x[N_base * 5 + i] = tempbuf[utemp + 5];
-						x[N_base * 6 + i] = tempbuf[utemp + 6];
-						x[N_base * 7 + i] = tempbuf[utemp + 7];
-						x[N_base * 8 + i] = tempbuf[utemp + 8];
-						x[N_base * 9 + i] = tempbuf[utemp + 9];
-						x[N_base * 10 + i] = tempbuf[utemp + 10];
-						x[N_base * 11 + i] = tempbuf[utemp + 11];
-						x[N_base * 12 + i] = tempbuf[utemp + 12];
-						x[N_base * 13 + i] = tempbuf[utemp + 13];
-						x[N_base * 14 + i] = tempbuf[utemp + 14];
-					}
-					if (j > i)  // bit reverse and copy
-					{
-						unsigned int utemp;
-						utemp = j*base;
-						x[i] = tempbuf[utemp];
-						x[N_base + i] = tempbuf[utemp + 1];
-						x[N_base * 2 + i] = tempbuf[utemp + 2];
-						x[N_base * 3 + i] = tempbuf[utemp + 3];
-						x[N_base * 4 + i] = tempbuf[utemp + 4];
-						x[N_base * 5 + i] = tempbuf[utemp + 5];
-						x[N_base * 6 + i] = tempbuf[utemp + 6];
-						x[N_base * 7 + i] = tempbuf[utemp + 7];
-						x[N_base * 8 + i] = tempbuf[utemp + 8];
-						x[N_base * 9 + i] = tempbuf[utemp + 9];
-						x[N_base * 10 + i] = tempbuf[utemp + 10];
-						x[N_base * 11 + i] = tempbuf[utemp + 11];
-						x[N_base * 12 + i] = tempbuf[utemp + 12];
-						x[N_base * 13 + i] = tempbuf[utemp + 13];
-						x[N_base * 14 + i] = tempbuf[utemp + 14];
-
-						utemp = i*base;
-						x[j] = tempbuf[utemp];
-						x[N_base + j] = tempbuf[utemp + 1];
-						x[N_base * 2 + j] = tempbuf[utemp + 2];
-						x[N_base * 3 + j] = tempbuf[utemp + 3];
-						x[N_base * 4 + j] = tempbuf[utemp + 4];
-						x[N_base * 5 + j] = tempbuf[utemp + 5];
-						x[N_base * 6 + j] = tempbuf[utemp + 6];
-						x[N_base * 7 + j] = tempbuf[utemp + 7];
-						x[N_base * 8 + j] = tempbuf[utemp + 8];
-						x[N_base * 9 + j] = tempbuf[utemp + 9];
-						x[N_base * 10 + j] = tempbuf[utemp + 10];
-						x[N_base * 11 + j] = tempbuf[utemp + 11];
-						x[N_base * 12 + j] = tempbuf[utemp + 12];
-						x[N_base * 13 + j] = tempbuf[utemp + 13];
-						x[N_base * 14 + j] = tempbuf[utemp + 14];
-					}
-					k = N_base / 2;
-					while (k >= 2 && j >= k)
-					{
-						j -= k;
-						k >>= 1;
-					}
-					j += k;
-				}
+	// Inverse FFT and synthesis of one frame with overlap-add. With N = FFTSize and y the inverse FFT of xin:
+	//      output[n]  = overlap[n] + scale * window[n] * y[n],  n < N/2
+	//      overlap[n] = scale * window[n + N/2] * y[n + N/2],   n < N/2
+	// The reordering to normal order, the scaling, the window and the overlap-add are one pass.
+	// window can be NULL. xin is used as work buffer and is overwritten.
+	void FFT::AecCcsInvFFTOverlapAdd(FFTPlan& plan, float * xin, bool coeffOrder, float scale, const float * window, float * overlap, float * output){
+		unsigned int half = (unsigned int)plan.size() / 2;
+		const unsigned int * first = plan.output_order();
+		const unsigned int * second = first + half;
+		unsigned int n;
+
+		InvFFTCore(plan, xin, xin, coeffOrder);
+		const float * y = plan.base() == 4 ? xin : plan.work();
+		if (window)
+		{
+			for (n = 0; n < half; n++)
+			{
+				output[n] = overlap[n] + scale * window[n] * y[first[n]];
+				overlap[n] = scale * window[n + half] * y[second[n]];
+			}
+		}
+		else
+		{
+			for (n = 0; n < half; n++)
+			{
+				output[n] = overlap[n] + scale * y[first[n]];
+				overlap[n] = scale * y[second[n]];
 			}
 		}
 	}
@@ -2,6 +2,7 @@
 #define FFT_H_
 
 #include <string.h>
+#include "FFTPlan.h"
 #include "GlobalConfig.h"
 #include "Utils.h"
 
@@ -9,30 +10,39 @@ namespace Beam{
 	class FFT {
 	public:
 		/// constructor with the size.
-		FFT();
-		~FFT();
-		/// compute FFT. make sure that output is allocated.
-		/// the input must have FRAME_SIZE.
-		/// the output must have FRAME_SIZE.
-		void analyze(std::vector<float>& input, std::vector<std::complex<float> >& output);
-		/// compute IFFT. make sure that output is allocated.
-		/// the input must have FRAME_SIZE.
-		/// the output must have FRAME_SIZE.
-		/// the output has half frame delay.
-		void synthesize(std::vector<std::complex<float> >& input, std::vector<float>& output);
+		FFT(int frame_size = FRAME_SIZE);
+		/// compute FFT of one frame, working on the caller's buffers. the window is applied while the input is loaded.
+		/// the input has 2 * frame_size samples, the previous frame followed by the current one. it is not changed.
+		/// the output receives frame_size bins.
+		void analyze(const float* input, std::complex<float>* output);
+		/// compute IFFT of one frame. the scaling, the window and the overlap-add are applied while the output is stored.
+		/// the input has frame_size bins, the output receives frame_size samples.
+		/// the output lags the newest input frame by one frame.
+		void synthesize(const std::complex<float>* input, float* output);
 		/// implementation of fft. copy from aecfft.c
-		static void AecCcsFwdFFT(float * xin, float * xout, bool coeffOrder);
+		/// the tables and scratch buffers come from the plan, which must have the size of the transform.
+		/// if window is not NULL the input is multiplied by it, in the pass that copies the input when xin != xout.
+		static void AecCcsFwdFFT(FFTPlan& plan, float * xin, float * xout, bool coeffOrder, const float * window = NULL);
 		/// implementation of ifft. copy from aecfft.c
-		static void AecCcsInvFFT(float * xin, float * xout, bool coeffOrder);
+		static void AecCcsInvFFT(FFTPlan& plan, float * xin, float * xout, bool coeffOrder);
+		/// inverse fft with the scaling, the synthesis window and the overlap-add fused into its last pass.
+		/// output receives plan.size() / 2 samples, overlap holds the second half of the previous frame
+		/// and receives that of this one. window can be NULL. xin is overwritten.
+		static void AecCcsInvFFTOverlapAdd(FFTPlan& plan, float * xin, bool coeffOrder, float scale, const float * window, float * overlap, float * output);
+		/// forward fft of plan.channels() sequences at once, in DFT_COEFF_ORDER_AEC.
+		/// input and output are channel-interleaved: x[n * plan.channels() + channel].
+		static void AecCcsFwdFFTBatch(FFTPlan& plan, float * xin, float * xout);
+		/// same as AecCcsFwdFFTBatch, computed with one complex fft per channel pair. needs plan.can_pack().
+		static void AecCcsFwdFFTPacked(FFTPlan& plan, float * xin, float * xout);
 	private:
-		float m_ha[FRAME_SIZE * 2];
-		float m_input[FRAME_SIZE * 2];
-		float m_input_prev[FRAME_SIZE];
-		float m_prev[FRAME_SIZE];
-		float m_current[FRAME_SIZE * 2];
+		int m_frame_size;
+		FFTPlan m_plan;
+		std::vector<float> m_ha;
+		std::vector<float> m_prev;
+		std::vector<float> m_out;
 		// data structures to compute FFT.
-		static float wr_15[15];
-		static float wi_15[15];
+		static const int map_15[5][3];
+		static void InvFFTCore(FFTPlan& plan, float * xin, float * xout, bool coeffOrder);
 		static void FwdFFT_base15(float * xin, float * xout);
 		static void InvFFT_base15(float * xin, float * xout);
 	};
@@ -0,0 +1,342 @@
+#include "FFTKernels.h"
+#include <algorithm>
+#include "FFT.h"
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#define BEAM_X86_SIMD
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#endif
+
+// gcc and clang only emit the instructions of a function's target, msvc always can.
+#if defined(__GNUC__) || defined(__clang__)
+#define BEAM_TARGET(isa) __attribute__((target(isa)))
+#else
+#define BEAM_TARGET(isa)
+#endif
+
+namespace Beam{
+#ifdef BEAM_X86_SIMD
+	/***************************************************************************
+	The kernels below are the inner loops of the butterfly stages in FFT.cpp,
+	computed for W consecutive j at once. For one group starting at x:
+	pr = j, pi = step - j, qr = step + j, qi = 2 * step - j.
+	pr and qr run forwards, pi and qi run backwards, so those two are loaded
+	and stored with their lanes reversed. The W butterflies never share memory
+	as long as j + W - 1 < (step + 1) / 2, see FFT::AecCcsFwdFFT.
+	***************************************************************************/
+	BEAM_TARGET("sse4.2") static inline __m128 reverse_sse(__m128 v){
+		return _mm_shuffle_ps(v, v, _MM_SHUFFLE(0, 1, 2, 3));
+	}
+
+	BEAM_TARGET("sse4.2") static inline unsigned int fwd_block_sse(float* x, unsigned int step, const float* tw_cos, const float* tw_sin, unsigned int j){
+		unsigned int end = (step + 1) / 2;
+		for (; j + 4 <= end; j += 4){
+			__m128 wr = _mm_loadu_ps(tw_cos + j);
+			__m128 ws = _mm_loadu_ps(tw_sin + j);  // wi = -ws
+			__m128 xpr = _mm_loadu_ps(x + j);
+			__m128 xqr = _mm_loadu_ps(x + step + j);
+			__m128 xpi = reverse_sse(_mm_loadu_ps(x + step - j - 3));
+			__m128 xqi = reverse_sse(_mm_loadu_ps(x + 2 * step - j - 3));
+			__m128 tempr = _mm_add_ps(_mm_mul_ps(xqr, wr), _mm_mul_ps(xqi, ws));
+			__m128 tempi = _mm_sub_ps(_mm_mul_ps(xqi, wr), _mm_mul_ps(xqr, ws));
+			_mm_storeu_ps(x + 2 * step - j - 3, reverse_sse(_mm_add_ps(xpi, tempi)));
+			_mm_storeu_ps(x + step + j, _mm_sub_ps(tempi, xpi));
+			_mm_storeu_ps(x + step - j - 3, reverse_sse(_mm_sub_ps(xpr, tempr)));
+			_mm_storeu_ps(x + j, _mm_add_ps(xpr, tempr));
+		}
+		return j;
+	}
+
+	BEAM_TARGET("sse4.2") static inline unsigned int inv_block_sse(float* x, unsigned int step, const float* tw_cos, const float* tw_sin, unsigned int j){
+		unsigned int end = (step + 1) / 2;
+		for (; j + 4 <= end; j += 4){
+			__m128 wr = _mm_loadu_ps(tw_cos + j);
+			__m128 wi = _mm_loadu_ps(tw_sin + j);
+			__m128 xpr = _mm_loadu_ps(x + j);
+			__m128 xqr = _mm_loadu_ps(x + step + j);
+			__m128 xpi = reverse_sse(_mm_loadu_ps(x + step - j - 3));
+			__m128 xqi = reverse_sse(_mm_loadu_ps(x + 2 * step - j - 3));
+			__m128 tempr = _mm_sub_ps(xpr, xpi);
+			__m128 tempi = _mm_add_ps(xqr, xqi);
+			_mm_storeu_ps(x + j, _mm_add_ps(xpr, xpi));
+			_mm_storeu_ps(x + step - j - 3, reverse_sse(_mm_sub_ps(xqi, xqr)));
+			_mm_storeu_ps(x + step + j, _mm_sub_ps(_mm_mul_ps(tempr, wr), _mm_mul_ps(tempi, wi)));
+			_mm_storeu_ps(x + 2 * step - j - 3, reverse_sse(_mm_add_ps(_mm_mul_ps(tempr, wi), _mm_mul_ps(tempi, wr))));
+		}
+		return j;
+	}
+
+	BEAM_TARGET("avx2,fma") static inline __m256 reverse_avx2(__m256 v){
+		return _mm256_permutevar8x32_ps(v, _mm256_set_epi32(0, 1, 2, 3, 4, 5, 6, 7));
+	}
+
+	BEAM_TARGET("avx2,fma") static inline unsigned int fwd_block_avx2(float* x, unsigned int step, const float* tw_cos, const float* tw_sin, unsigned int j){
+		unsigned int end = (step + 1) / 2;
+		for (; j + 8 <= end; j += 8){
+			__m256 wr = _mm256_loadu_ps(tw_cos + j);
+			__m256 ws = _mm256_loadu_ps(tw_sin + j);  // wi = -ws
+			__m256 xpr = _mm256_loadu_ps(x + j);
+			__m256 xqr = _mm256_loadu_ps(x + step + j);
+			__m256 xpi = reverse_avx2(_mm256_loadu_ps(x + step - j - 7));
+			__m256 xqi = reverse_avx2(_mm256_loadu_ps(x + 2 * step - j - 7));
+			__m256 tempr = _mm256_fmadd_ps(xqr, wr, _mm256_mul_ps(xqi, ws));
+			__m256 tempi = _mm256_fmsub_ps(xqi, wr, _mm256_mul_ps(xqr, ws));
+			_mm256_storeu_ps(x + 2 * step - j - 7, reverse_avx2(_mm256_add_ps(xpi, tempi)));
+			_mm256_storeu_ps(x + step + j, _mm256_sub_ps(tempi, xpi));
+			_mm256_storeu_ps(x + step - j - 7, reverse_avx2(_mm256_sub_ps(xpr, tempr)));
+			_mm256_storeu_ps(x + j, _mm256_add_ps(xpr, tempr));
+		}
+		return j;
+	}
+
+	BEAM_TARGET("avx2,fma") static inline unsigned int inv_block_avx2(float* x, unsigned int step, const float* tw_cos, const float* tw_sin, unsigned int j){
+		unsigned int end = (step + 1) / 2;
+		for (; j + 8 <= end; j += 8){
+			__m256 wr = _mm256_loadu_ps(tw_cos + j);
+			__m256 wi = _mm256_loadu_ps(tw_sin + j);
+			__m256 xpr = _mm256_loadu_ps(x + j);
+			__m256 xqr = _mm256_loadu_ps(x + step + j);
+			__m256 xpi = reverse_avx2(_mm256_loadu_ps(x + step - j - 7));
+			__m256 xqi = reverse_avx2(_mm256_loadu_ps(x + 2 * step - j - 7));
+			__m256 tempr = _mm256_sub_ps(xpr, xpi);
+			__m256 tempi = _mm256_add_ps(xqr, xqi);
+			_mm256_storeu_ps(x + j, _mm256_add_ps(xpr, xpi));
+			_mm256_storeu_ps(x + step - j - 7, reverse_avx2(_mm256_sub_ps(xqi, xqr)));
+			_mm256_storeu_ps(x + step + j, _mm256_fmsub_ps(tempr, wr, _mm256_mul_ps(tempi, wi)));
+			_mm256_storeu_ps(x + 2 * step - j - 7, reverse_avx2(_mm256_fmadd_ps(tempr, wi, _mm256_mul_ps(tempi, wr))));
+		}
+		return j;
+	}
+
+	BEAM_TARGET("avx512f") static inline __m512 reverse_avx512(__m512 v){
+		return _mm512_permutexvar_ps(_mm512_set_epi32(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15), v);
+	}
+
+	BEAM_TARGET("avx512f") static inline unsigned int fwd_block_avx512(float* x, unsigned int step, const float* tw_cos, const float* tw_sin, unsigned int j){
+		unsigned int end = (step + 1) / 2;
+		for (; j + 16 <= end; j += 16){
+			__m512 wr = _mm512_loadu_ps(tw_cos + j);
+			__m512 ws = _mm512_loadu_ps(tw_sin + j);  // wi = -ws
+			__m512 xpr = _mm512_loadu_ps(x + j);
+			__m512 xqr = _mm512_loadu_ps(x + step + j);
+			__m512 xpi = reverse_avx512(_mm512_loadu_ps(x + step - j - 15));
+			__m512 xqi = reverse_avx512(_mm512_loadu_ps(x + 2 * step - j - 15));
+			__m512 tempr = _mm512_fmadd_ps(xqr, wr, _mm512_mul_ps(xqi, ws));
+			__m512 tempi = _mm512_fmsub_ps(xqi, wr, _mm512_mul_ps(xqr, ws));
+			_mm512_storeu_ps(x + 2 * step - j - 15, reverse_avx512(_mm512_add_ps(xpi, tempi)));
+			_mm512_storeu_ps(x + step + j, _mm512_sub_ps(tempi, xpi));
+			_mm512_storeu_ps(x + step - j - 15, reverse_avx512(_mm512_sub_ps(xpr, tempr)));
+			_mm512_storeu_ps(x + j, _mm512_add_ps(xpr, tempr));
+		}
+		return j;
+	}
+
+	BEAM_TARGET("avx512f") static inline unsigned int inv_block_avx512(float* x, unsigned int step, const float* tw_cos, const float* tw_sin, unsigned int j){
+		unsigned int end = (step + 1) / 2;
+		for (; j + 16 <= end; j += 16){
+			__m512 wr = _mm512_loadu_ps(tw_cos + j);
+			__m512 wi = _mm512_loadu_ps(tw_sin + j);
+			__m512 xpr = _mm512_loadu_ps(x + j);
+			__m512 xqr = _mm512_loadu_ps(x + step + j);
+			__m512 xpi = reverse_avx512(_mm512_loadu_ps(x + step - j - 15));
+			__m512 xqi = reverse_avx512(_mm512_loadu_ps(x + 2 * step - j - 15));
+			__m512 tempr = _mm512_sub_ps(xpr, xpi);
+			__m512 tempi = _mm512_add_ps(xqr, xqi);
+			_mm512_storeu_ps(x + j, _mm512_add_ps(xpr, xpi));
+			_mm512_storeu_ps(x + step - j - 15, reverse_avx512(_mm512_sub_ps(xqi, xqr)));
+			_mm512_storeu_ps(x + step + j, _mm512_fmsub_ps(tempr, wr, _mm512_mul_ps(tempi, wi)));
+			_mm512_storeu_ps(x + 2 * step - j - 15, reverse_avx512(_mm512_fmadd_ps(tempr, wi, _mm512_mul_ps(tempi, wr))));
+		}
+		return j;
+	}
+
+	// each kernel finishes the group with the narrower blocks, so the scalar code only sees the last 3 butterflies.
+	BEAM_TARGET("sse4.2") static unsigned int fwd_sse42(float* x, unsigned int step, const float* tw_cos, const float* tw_sin){
+		return fwd_block_sse(x, step, tw_cos, tw_sin, 1);
+	}
+
+	BEAM_TARGET("sse4.2") static unsigned int inv_sse42(float* x, unsigned int step, const float* tw_cos, const float* tw_sin){
+		return inv_block_sse(x, step, tw_cos, tw_sin, 1);
+	}
+
+	BEAM_TARGET("avx2,fma") static unsigned int fwd_avx2(float* x, unsigned int step, const float* tw_cos, const float* tw_sin){
+		unsigned int j = fwd_block_avx2(x, step, tw_cos, tw_sin, 1);
+		return fwd_block_sse(x, step, tw_cos, tw_sin, j);
+	}
+
+	BEAM_TARGET("avx2,fma") static unsigned int inv_avx2(float* x, unsigned int step, const float* tw_cos, const float* tw_sin){
+		unsigned int j = inv_block_avx2(x, step, tw_cos, tw_sin, 1);
+		return inv_block_sse(x, step, tw_cos, tw_sin, j);
+	}
+
+	BEAM_TARGET("avx512f,avx2,fma") static unsigned int fwd_avx512(float* x, unsigned int step, const float* tw_cos, const float* tw_sin){
+		unsigned int j = fwd_block_avx512(x, step, tw_cos, tw_sin, 1);
+		j = fwd_block_avx2(x, step, tw_cos, tw_sin, j);
+		return fwd_block_sse(x, step, tw_cos, tw_sin, j);
+	}
+
+	BEAM_TARGET("avx512f,avx2,fma") static unsigned int inv_avx512(float* x, unsigned int step, const float* tw_cos, const float* tw_sin){
+		unsigned int j = inv_block_avx512(x, step, tw_cos, tw_sin, 1);
+		j = inv_block_avx2(x, step, tw_cos, tw_sin, j);
+		return inv_block_sse(x, step, tw_cos, tw_sin, j);
+	}
+
+	static bool cpu_supports(FFTKernelType kernel){
+#if defined(__GNUC__) || defined(__clang__)
+		__builtin_cpu_init();
+		switch (kernel){
+		case FFT_KERNEL_SSE42:
+			return __builtin_cpu_supports("sse4.2") != 0;
+		case FFT_KERNEL_AVX2:
+			return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+		case FFT_KERNEL_AVX512:
+			return __builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+		default:
+			return true;
+		}
+#elif defined(_MSC_VER)
+		int info[4];
+		__cpuid(info, 1);
+		bool sse42 = (info[2] & (1 << 20)) != 0;
+		bool fma = (info[2] & (1 << 12)) != 0;
+		bool osxsave = (info[2] & (1 << 27)) != 0;
+		unsigned long long xcr0 = osxsave ? _xgetbv(0) : 0;
+		bool ymm = (xcr0 & 0x06) == 0x06;
+		bool zmm = (xcr0 & 0xe6) == 0xe6;
+		__cpuidex(info, 7, 0);
+		bool avx2 = (info[1] & (1 << 5)) != 0;
+		bool avx512f = (info[1] & (1 << 16)) != 0;
+		switch (kernel){
+		case FFT_KERNEL_SSE42:
+			return sse42;
+		case FFT_KERNEL_AVX2:
+			return avx2 && fma && ymm;
+		case FFT_KERNEL_AVX512:
+			return avx512f && avx2 && fma && zmm;
+		default:
+			return true;
+		}
+#else
+		return kernel == FFT_KERNEL_SCALAR;
+#endif
+	}
+
+	// bit k is set if the cpu supports kernel k.
+	static int supported_mask(){
+		int mask = 1;
+		for (int k = FFT_KERNEL_SSE42; k < FFT_KERNEL_COUNT; ++k){
+			if (cpu_supports((FFTKernelType)k)){
+				mask |= 1 << k;
+			}
+		}
+		return mask;
+	}
+#endif
+
+	const char* FFTKernels::name(FFTKernelType kernel){
+		switch (kernel){
+		case FFT_KERNEL_SSE42:
+			return "sse4.2";
+		case FFT_KERNEL_AVX2:
+			return "avx2";
+		case FFT_KERNEL_AVX512:
+			return "avx512";
+		default:
+			return "scalar";
+		}
+	}
+
+	bool FFTKernels::supported(FFTKernelType kernel){
+		if (kernel == FFT_KERNEL_SCALAR){
+			return true;
+		}
+#ifdef BEAM_X86_SIMD
+		// initialized once, also when pipelines are created on several threads.
+		static const int supported_kernels = supported_mask();
+		return (supported_kernels & (1 << kernel)) != 0;
+#else
+		return false;
+#endif
+	}
+
+	FFTKernelType FFTKernels::best(){
+		for (int k = FFT_KERNEL_COUNT - 1; k > FFT_KERNEL_SCALAR; --k){
+			if (supported((FFTKernelType)k)){
+				return (FFTKernelType)k;
+			}
+		}
+		return FFT_KERNEL_SCALAR;
+	}
+
+	FFTButterflyKernel FFTKernels::forward(FFTKernelType kernel){
+#ifdef BEAM_X86_SIMD
+		switch (kernel){
+		case FFT_KERNEL_SSE42:
+			return fwd_sse42;
+		case FFT_KERNEL_AVX2:
+			return fwd_avx2;
+		case FFT_KERNEL_AVX512:
+			return fwd_avx512;
+		default:
+			break;
+		}
+#endif
+		return NULL;
+	}
+
+	FFTButterflyKernel FFTKernels::inverse(FFTKernelType kernel){
+#ifdef BEAM_X86_SIMD
+		switch (kernel){
+		case FFT_KERNEL_SSE42:
+			return inv_sse42;
+		case FFT_KERNEL_AVX2:
+			return inv_avx2;
+		case FFT_KERNEL_AVX512:
+			return inv_avx512;
+		default:
+			break;
+		}
+#endif
+		return NULL;
+	}
+
+	float FFTKernels::max_error(FFTKernelType kernel, int size){
+		FFTPlan reference(size);
+		FFTPlan plan(size);
+		reference.set_kernel(FFT_KERNEL_SCALAR);
+		plan.set_kernel(kernel);
+		std::vector<float> input(size);
+		std::vector<float> expected(size + 2);
+		std::vector<float> actual(size + 2);
+		// deterministic test signal: a few tones plus a pseudo random sequence.
+		unsigned int seed = 12345;
+		for (int i = 0; i < size; ++i){
+			seed = seed * 1103515245u + 12345u;
+			float noise = (float)((seed >> 9) & 0xffff) / 65536.f - 0.5f;
+			input[i] = sinf(0.05f * i) + 0.5f * cosf(1.3f * i + 0.2f) + noise;
+		}
+		float max_value = 0.f;
+		float max_diff = 0.f;
+		FFT::AecCcsFwdFFT(reference, &input[0], &expected[0], true);
+		FFT::AecCcsFwdFFT(plan, &input[0], &actual[0], true);
+		for (int i = 0; i < size; ++i){
+			max_value = std::max(max_value, fabsf(expected[i]));
+			max_diff = std::max(max_diff, fabsf(expected[i] - actual[i]));
+		}
+		// invert the scalar spectrum so that both inverse transforms see the same input.
+		std::vector<float> spectrum(expected);
+		FFT::AecCcsInvFFT(reference, &spectrum[0], &expected[0], true);
+		FFT::AecCcsInvFFT(plan, &spectrum[0], &actual[0], true);
+		for (int i = 0; i < size; ++i){
+			max_value = std::max(max_value, fabsf(expected[i]));
+			max_diff = std::max(max_diff, fabsf(expected[i] - actual[i]));
+		}
+		if (max_value == 0.f){
+			return max_diff;
+		}
+		return max_diff / max_value;
+	}
+}
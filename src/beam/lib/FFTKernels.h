@@ -0,0 +1,37 @@
+#ifndef FFTKERNELS_H_
+#define FFTKERNELS_H_
+
+namespace Beam{
+	/// instruction sets that have a butterfly kernel for the AEC CCS real FFT.
+	enum FFTKernelType{
+		FFT_KERNEL_SCALAR = 0,
+		FFT_KERNEL_SSE42,
+		FFT_KERNEL_AVX2,
+		FFT_KERNEL_AVX512,
+		FFT_KERNEL_COUNT
+	};
+	/// computes the butterflies j = 1, 2, ... of one group starting at x, for the stage with the given step.
+	/// works on blocks of 4 or more butterflies and returns the first j that is not computed;
+	/// the caller finishes the group with the scalar code.
+	typedef unsigned int(*FFTButterflyKernel)(float* x, unsigned int step, const float* tw_cos, const float* tw_sin);
+
+	/// SIMD versions of the radix-2 butterflies in FFT::AecCcsFwdFFT / AecCcsInvFFT with runtime cpu dispatch.
+	class FFTKernels {
+	public:
+		/// name of the kernel, e.g. "avx2".
+		static const char* name(FFTKernelType kernel);
+		/// true if both the build and the cpu can run the kernel.
+		static bool supported(FFTKernelType kernel);
+		/// the fastest supported kernel. the cpu is only queried once.
+		static FFTKernelType best();
+		/// forward butterflies of the kernel, NULL for the scalar code.
+		static FFTButterflyKernel forward(FFTKernelType kernel);
+		/// inverse butterflies of the kernel, NULL for the scalar code.
+		static FFTButterflyKernel inverse(FFTKernelType kernel);
+		/// largest difference between the kernel and the scalar code over a forward and an inverse transform
+		/// of the given size, relative to the largest magnitude of the scalar result.
+		static float max_error(FFTKernelType kernel, int size);
+	};
+}
+
+#endif /* FFTKERNELS_H_ */
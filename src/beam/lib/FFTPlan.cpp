@@ -0,0 +1,134 @@
+#include <algorithm>
+#include "FFTPlan.h"
+
+namespace Beam{
+	FFTPlan::FFTPlan(int size, int channels) : m_size(size), m_channels(channels), m_packed(false){
+		unsigned int FFTSize = (unsigned int)size;
+		unsigned int i, j, k;
+		if ((FFTSize & (-(int)FFTSize)) == FFTSize){ // detect if FFTSize is power of 2
+			m_base = 4;
+		}
+		else{
+			if (FFTSize % 15)
+				m_base = 5;
+			else
+				m_base = 15;
+		}
+		unsigned int base = (unsigned int)m_base;
+		unsigned int N_base = FFTSize / base;  //number of base transforms
+
+		// sin table of sin(2*pi*(0:FFTSize/4)/FFTSize), same values as the table aecfft.c used to build per call.
+		std::vector<float> sin_tab(FFTSize / 4 + 1);
+		for (i = 0; i <= FFTSize / 4; i++){
+			sin_tab[i] = (float)sinf(2.0f * (float)PI * i / FFTSize);
+		}
+		const float* cos_tab = &sin_tab[0] + FFTSize / 4;
+		// twiddles for each butterfly stage, stored contiguously so that j indexes them directly.
+		for (unsigned int step = base, n = N_base; step < FFTSize; step *= 2, n /= 2){
+			m_stage_offset.push_back((int)m_twiddle_cos.size());
+			for (j = 0; j < (step + 1) / 2; j++){
+				int r = j * n / 2;      // power of W  (0 <= r <= FFTSize/4)
+				m_twiddle_cos.push_back(cos_tab[-r]);
+				m_twiddle_sin.push_back(sin_tab[r]);
+			}
+		}
+
+		// bit reversal
+		if (base == 4){
+			for (i = 0, j = 0; i < FFTSize; i++){
+				if (j > i){
+					m_swap_first.push_back(i);
+					m_swap_second.push_back(j);
+				}
+				k = FFTSize / 2;
+				while (k >= 2 && j >= k){
+					j -= k;
+					k >>= 1;
+				}
+				j += k;
+			}
+		}
+		else{
+			// bit reverse the lower bits corresponding to N_base, keep the prime factor in the highest bits.
+			// see the table in FFT::AecCcsFwdFFT.
+			m_permutation.assign(FFTSize, 0);
+			for (i = 0, j = 0; i < N_base && j < N_base; i++){
+				for (unsigned int r = 0; r < base; r++){
+					m_permutation[j * base + r] = N_base * r + i;
+					m_permutation[i * base + r] = N_base * r + j;
+				}
+				k = N_base / 2;
+				while (k >= 2 && j >= k){
+					j -= k;
+					k >>= 1;
+				}
+				j += k;
+			}
+		}
+
+		// MCLT modulation. computed in double precision from the angle, the MCLT used to rotate
+		// from bin to bin, which accumulates the rounding error of float along the spectrum.
+		double mclt_step = PI * (FFTSize / 2 + 1) / FFTSize;
+		for (int phase = 0; phase < 4; phase++){
+			for (i = 0; i <= FFTSize / 2; i++){
+				double angle = PI / 4.0 + i * mclt_step + PI * phase * (i - 0.5);
+				m_mclt_cos.push_back((float)cos(angle));
+				m_mclt_sin.push_back((float)sin(angle));
+			}
+		}
+
+		// gathers for the out-of-place reordering
+		m_input_order.resize(FFTSize);
+		m_output_order.resize(FFTSize);
+		if (base == 4){
+			// the swaps applied to the identity, the inverse transform applies the same swaps.
+			for (i = 0; i < FFTSize; i++){
+				m_input_order[i] = i;
+			}
+			for (i = 0; i < m_swap_first.size(); i++){
+				std::swap(m_input_order[m_swap_first[i]], m_input_order[m_swap_second[i]]);
+			}
+			m_output_order = m_input_order;
+		}
+		else{
+			m_input_order = m_permutation;
+			for (i = 0; i < FFTSize; i++){
+				m_output_order[m_permutation[i]] = i;
+			}
+		}
+
+		// complex transform for the packed analysis of channel pairs.
+		if (can_pack()){
+			for (i = 0; i < FFTSize / 2; i++){
+				m_complex_cos.push_back(i <= FFTSize / 4 ? cos_tab[-(int)i] : -cos_tab[-(int)(FFTSize / 2 - i)]);
+				m_complex_sin.push_back(-(i <= FFTSize / 4 ? sin_tab[i] : sin_tab[FFTSize / 2 - i]));
+			}
+			for (i = 0, j = 0; i < FFTSize; i++){
+				if (j > i){
+					m_complex_swap_first.push_back(i);
+					m_complex_swap_second.push_back(j);
+				}
+				k = FFTSize / 2;
+				while (k >= 1 && j >= k){
+					j -= k;
+					k >>= 1;
+				}
+				j += k;
+			}
+		}
+
+		m_work.assign(std::max(FFTSize + 2, FFTSize * channels), 0.f);
+		m_scratch[0].assign(2 * FFTSize * channels, 0.f);
+		m_scratch[1].assign(2 * FFTSize * channels, 0.f);
+		set_kernel(FFTKernels::best());
+	}
+
+	void FFTPlan::set_kernel(FFTKernelType kernel){
+		if (!FFTKernels::supported(kernel)){
+			kernel = FFT_KERNEL_SCALAR;
+		}
+		m_kernel = kernel;
+		m_fwd_kernel = FFTKernels::forward(kernel);
+		m_inv_kernel = FFTKernels::inverse(kernel);
+	}
+}
@@ -0,0 +1,98 @@
+#ifndef FFTPLAN_H_
+#define FFTPLAN_H_
+
+#include <vector>
+#include "FFTKernels.h"
+#include "GlobalConfig.h"
+#include "Utils.h"
+
+namespace Beam{
+	/// precomputed tables and scratch buffers for one size of the AEC CCS real FFT.
+	/// build it once and pass it to FFT::AecCcsFwdFFT / AecCcsInvFFT and the MCLT.
+	/// the tables are constant after construction, the scratch buffers are not,
+	/// so one plan must not be used by two threads at the same time.
+	class FFTPlan {
+	public:
+		/// size must be 2^n, 5*2^n or 15*2^n.
+		/// channels is the number of channels the batched transforms process at once, see FFT::AecCcsFwdFFTBatch.
+		FFTPlan(int size = TWO_FRAME_SIZE, int channels = 1);
+		/// length of the real time sequence.
+		int size() const { return m_size; }
+		/// size of the base transform: 4, 5 or 15.
+		int base() const { return m_base; }
+		/// number of channels of the batched transforms.
+		int channels() const { return m_channels; }
+		/// number of butterfly stages after the base transform.
+		int num_stages() const { return (int)m_stage_offset.size(); }
+		/// twiddles of the stage with step = base << stage. entry j is cos(pi * j / step).
+		const float* twiddle_cos(int stage) const { return &m_twiddle_cos[m_stage_offset[stage]]; }
+		/// twiddles of the stage with step = base << stage. entry j is sin(pi * j / step).
+		const float* twiddle_sin(int stage) const { return &m_twiddle_sin[m_stage_offset[stage]]; }
+		/// in-place bit reversal for power of 2 sizes: swap x[swap_first[k]] and x[swap_second[k]].
+		int num_swaps() const { return (int)m_swap_first.size(); }
+		const unsigned int* swap_first() const { return m_swap_first.data(); }
+		const unsigned int* swap_second() const { return m_swap_second.data(); }
+		/// mixed-radix reordering for base 5 and 15: work[k] = x[permutation[k]].
+		const unsigned int* permutation() const { return m_permutation.data(); }
+		/// the same reorderings as gathers, for all bases: the forward transform starts with
+		/// x[input_order[k]] at position k, the inverse transform leaves output sample n at position output_order[n].
+		/// they let an out-of-place transform reorder, window and scale in the same pass.
+		const unsigned int* input_order() const { return m_input_order.data(); }
+		const unsigned int* output_order() const { return m_output_order.data(); }
+		/// SIMD kernel of the butterflies. the constructor picks the fastest one the cpu supports.
+		FFTKernelType kernel() const { return m_kernel; }
+		/// select the kernel, e.g. to compare it with the scalar code. falls back to scalar if unsupported.
+		void set_kernel(FFTKernelType kernel);
+		/// butterflies of the selected kernel, NULL for the scalar code.
+		FFTButterflyKernel fwd_kernel() const { return m_fwd_kernel; }
+		FFTButterflyKernel inv_kernel() const { return m_inv_kernel; }
+		/// true if the batched analysis can pack channel pairs into one complex transform:
+		/// the size is a power of 2 and the number of channels is even.
+		bool can_pack() const { return m_base == 4 && m_channels % 2 == 0; }
+		/// pack channel pairs in the batched analysis, see FFT::AecCcsFwdFFTPacked. ignored if !can_pack().
+		void set_packed(bool packed) { m_packed = packed && can_pack(); }
+		bool packed() const { return m_packed; }
+		/// twiddles of the complex transform of the packed analysis: cos[k] + i * sin[k] = exp(-2 * pi * i * k / size), k < size / 2.
+		const float* complex_twiddle_cos() const { return m_complex_cos.data(); }
+		const float* complex_twiddle_sin() const { return m_complex_sin.data(); }
+		/// full bit reversal of the complex transform: swap z[complex_swap_first[k]] and z[complex_swap_second[k]].
+		int num_complex_swaps() const { return (int)m_complex_swap_first.size(); }
+		const unsigned int* complex_swap_first() const { return m_complex_swap_first.data(); }
+		const unsigned int* complex_swap_second() const { return m_complex_swap_second.data(); }
+		/// modulation of the DFT-to-MCLT mapping for an MCLT of size() / 2 bins, entries m = 0 ... size() / 2:
+		/// mclt_cos[m] + i * mclt_sin[m] = exp(i * (pi / 4 + m * pi * (size() / 2 + 1) / size() + pi * phase * (m - 1 / 2))).
+		/// the forward MCLT uses the conjugate. phase 1 ... 3 fold the frame phase compensation into the modulation, see MCLT.h.
+		const float* mclt_cos(int phase = 0) const { return &m_mclt_cos[(phase & 3) * (m_size / 2 + 1)]; }
+		const float* mclt_sin(int phase = 0) const { return &m_mclt_sin[(phase & 3) * (m_size / 2 + 1)]; }
+		/// scratch buffer used inside the transform. holds size + 2 floats, or size * channels floats if that is more.
+		float* work() { return &m_work[0]; }
+		/// scratch buffers for the callers of the transform (e.g. MCLT). each holds 2 * size * channels floats.
+		float* scratch(int index) { return &m_scratch[index][0]; }
+	private:
+		int m_size;
+		int m_base;
+		int m_channels;
+		bool m_packed;
+		FFTKernelType m_kernel;
+		FFTButterflyKernel m_fwd_kernel;
+		FFTButterflyKernel m_inv_kernel;
+		std::vector<float> m_twiddle_cos;
+		std::vector<float> m_twiddle_sin;
+		std::vector<int> m_stage_offset;
+		std::vector<unsigned int> m_swap_first;
+		std::vector<unsigned int> m_swap_second;
+		std::vector<unsigned int> m_permutation;
+		std::vector<unsigned int> m_input_order;
+		std::vector<unsigned int> m_output_order;
+		std::vector<float> m_mclt_cos;
+		std::vector<float> m_mclt_sin;
+		std::vector<float> m_complex_cos;
+		std::vector<float> m_complex_sin;
+		std::vector<unsigned int> m_complex_swap_first;
+		std::vector<unsigned int> m_complex_swap_second;
+		std::vector<float> m_work;
+		std::vector<float> m_scratch[2];
+	};
+}
+
+#endif /* FFTPLAN_H_ */
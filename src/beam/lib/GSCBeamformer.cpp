@@ -1,56 +1,62 @@
 #include "GSCBeamformer.h"
 
 namespace Beam{
-	GSCBeamformer::GSCBeamformer(){
+	GSCBeamformer::GSCBeamformer(int frame_size) : m_frame_size(frame_size){
 		for (int i = 0; i < MAX_MICROPHONES; ++i){
-			std::fill(m_input_prev[i], m_input_prev[i] + FRAME_SIZE, 0.f);
-			std::fill(m_y_prev[i], m_y_prev[i] + FRAME_SIZE, 0.f);
+			m_input_prev[i].assign(frame_size, 0.f);
+			m_y_prev[i].assign(frame_size, 0.f);
+			m_y[i].assign(frame_size, 0.f);
 			std::fill(m_bm[i], m_bm[i] + BM_N, 1.f / BM_N);
 			std::fill(m_mc[i], m_mc[i] + MC_L, 1.f / MC_L);
 		}
-		std::fill(m_d_prev, m_d_prev + FRAME_SIZE, 0.f);
+		m_d_prev.assign(frame_size, 0.f);
+		m_d.assign(frame_size, 0.f);
 	}
 
 	GSCBeamformer::~GSCBeamformer(){
 	
 	}
 
-	void GSCBeamformer::compute(float output[FRAME_SIZE], float input[][FRAME_SIZE], float angle, bool voice, float ref[FRAME_SIZE]){
+	void GSCBeamformer::compute(float* output, float* input, float angle, bool voice, float* ref){
 		// skip delay sum beamformer now.
 		// process in the time domain.
 		int bm_p = 4;
 		int bm_n = 8;
-		float d[FRAME_SIZE] = { 0.f };
-		float y[MAX_MICROPHONES][FRAME_SIZE] = { 0.f };
-		std::fill(output, output + FRAME_SIZE, 0.f);
+		std::vector<float>& d = m_d;
+		std::vector<float>* y = m_y;
+		std::fill(d.begin(), d.end(), 0.f);
+		for (int channel = 0; channel < MAX_MICROPHONES; ++channel){
+			std::fill(y[channel].begin(), y[channel].end(), 0.f);
+		}
+		std::fill(output, output + m_frame_size, 0.f);
 		if (ref != NULL){
-			std::copy(ref, ref + FRAME_SIZE, d);
+			std::copy(ref, ref + m_frame_size, d.begin());
 		}
 		else{
-			for (int bin = 0; bin < FRAME_SIZE; ++bin){
+			for (int bin = 0; bin < m_frame_size; ++bin){
 				for (int channel = 0; channel < MAX_MICROPHONES; ++channel){
-					d[bin] += input[channel][bin];
+					d[bin] += input[channel * m_frame_size + bin];
 				}
 				d[bin] /= MAX_MICROPHONES;
 			}
 		}
 		// gsc bm
 
-		for (int k = 0; k < FRAME_SIZE; ++k){
+		for (int k = 0; k < m_frame_size; ++k){
 			if (voice){
 				for (int channel = 0; channel < MAX_MICROPHONES; ++channel){
 					float x = 0.f;
 					if (k - BM_P < 0){
-						x = m_input_prev[channel][FRAME_SIZE + k - BM_P];
+						x = m_input_prev[channel][m_frame_size + k - BM_P];
 					}
 					else{
-						x = input[channel][k - BM_P];
+						x = input[channel * m_frame_size + k - BM_P];
 					}
 					float sum = 0.f;
 					float norm = 0.f;
 					for (int j = 0; j < BM_N; ++j){
 						if (k - j < 0){
-							float v = m_d_prev[FRAME_SIZE + k - j];
+							float v = m_d_prev[m_frame_size + k - j];
 							sum += m_bm[channel][j] * v;
 							norm += v * v;
 						}
@@ -65,7 +71,7 @@ namespace Beam{
 					if (norm != 0.f){
 						for (int j = 0; j < BM_N; ++j){
 							if (k - j < 0){
-								m_bm[channel][j] += e / norm * m_d_prev[FRAME_SIZE + k - j];
+								m_bm[channel][j] += e / norm * m_d_prev[m_frame_size + k - j];
 							}
 							else{
 								m_bm[channel][j] += e / norm * d[k - j];
@@ -78,15 +84,15 @@ namespace Beam{
 			for (int channel = 0; channel < MAX_MICROPHONES; ++channel){
 				float x = 0.f;
 				if (k - BM_P < 0){
-					x = m_input_prev[channel][FRAME_SIZE + k - BM_P];
+					x = m_input_prev[channel][m_frame_size + k - BM_P];
 				}
 				else{
-					x = input[channel][k - BM_P];
+					x = input[channel * m_frame_size + k - BM_P];
 				}
 				float sum = 0.f;
 				for (int j = 0; j < BM_N; ++j){
 					if (k - j < 0){
-						float v = m_d_prev[FRAME_SIZE + k - j];
+						float v = m_d_prev[m_frame_size + k - j];
 						sum += m_bm[channel][j] * v;
 					}
 					else{
@@ -103,8 +109,8 @@ namespace Beam{
 				for (int channel = 0; channel < MAX_MICROPHONES; ++channel){
 					for (int j = 0; j < MC_L; ++j){
 						if (k - j < 0){
-							z -= m_y_prev[channel][FRAME_SIZE + k - j] * m_mc[channel][j];
-							norm += m_y_prev[channel][FRAME_SIZE + k - j] * m_y_prev[channel][FRAME_SIZE + k - j];
+							z -= m_y_prev[channel][m_frame_size + k - j] * m_mc[channel][j];
+							norm += m_y_prev[channel][m_frame_size + k - j] * m_y_prev[channel][m_frame_size + k - j];
 						}
 						else{
 							z -= y[channel][k - j] * m_mc[channel][j];
@@ -113,7 +119,7 @@ namespace Beam{
 					}
 				}
 				if (k - MC_Q < 0){
-					z += m_d_prev[FRAME_SIZE + k - MC_Q];
+					z += m_d_prev[m_frame_size + k - MC_Q];
 				}
 				else{
 					z += d[k - MC_Q];
@@ -122,7 +128,7 @@ namespace Beam{
 					for (int channel = 0; channel < MAX_MICROPHONES; ++channel){
 						for (int j = 0; j < MC_L; ++j){
 							if (k - j < 0){
-								m_mc[channel][j] += z / norm * m_y_prev[channel][FRAME_SIZE + k - j];
+								m_mc[channel][j] += z / norm * m_y_prev[channel][m_frame_size + k - j];
 							}
 							else{
 								m_mc[channel][j] += z / norm * y[channel][k - j];
@@ -135,7 +141,7 @@ namespace Beam{
 			for (int channel = 0; channel < MAX_MICROPHONES; ++channel){
 				for (int j = 0; j < MC_L; ++j){
 					if (k - j < 0){
-						z -= m_y_prev[channel][FRAME_SIZE + k - j] * m_mc[channel][j];
+						z -= m_y_prev[channel][m_frame_size + k - j] * m_mc[channel][j];
 					}
 					else{
 						z -= y[channel][k - j] * m_mc[channel][j];
@@ -143,7 +149,7 @@ namespace Beam{
 				}
 			}
 			if (k - MC_Q < 0){
-				z += m_d_prev[FRAME_SIZE + k - MC_Q];
+				z += m_d_prev[m_frame_size + k - MC_Q];
 			}
 			else{
 				z += d[k - MC_Q];
@@ -152,10 +158,10 @@ namespace Beam{
 		}
 		// copy input. copy y.
 		for (int channel = 0; channel < MAX_MICROPHONES; ++channel){
-			std::copy(input[channel], input[channel] + FRAME_SIZE, m_input_prev[channel]);
-			std::copy(y[channel], y[channel] + FRAME_SIZE, m_y_prev[channel]);
+			std::copy(input + channel * m_frame_size, input + (channel + 1) * m_frame_size, m_input_prev[channel].begin());
+			std::copy(y[channel].begin(), y[channel].end(), m_y_prev[channel].begin());
 		}
 		// copy d.
-		std::copy(d, d + FRAME_SIZE, m_d_prev);
+		std::copy(d.begin(), d.end(), m_d_prev.begin());
 	}
 }
\ No newline at end of file
@@ -11,13 +11,18 @@ namespace Beam{
 #define MC_L 16
 	class GSCBeamformer {
 	public:
-		GSCBeamformer();
+		GSCBeamformer(int frame_size = FRAME_SIZE);
 		~GSCBeamformer();
-		void compute(float output[FRAME_SIZE], float input[][FRAME_SIZE], float angle, bool voice, float ref[FRAME_SIZE] = NULL);
+		/// output and ref have frame_size samples.
+		/// input holds MAX_MICROPHONES frames of frame_size samples, channel after channel.
+		void compute(float* output, float* input, float angle, bool voice, float* ref = NULL);
 	private:
-		float m_input_prev[MAX_MICROPHONES][FRAME_SIZE];
-		float m_d_prev[FRAME_SIZE];
-		float m_y_prev[MAX_MICROPHONES][FRAME_SIZE];
+		int m_frame_size;
+		std::vector<float> m_input_prev[MAX_MICROPHONES];
+		std::vector<float> m_d_prev;
+		std::vector<float> m_y_prev[MAX_MICROPHONES];
+		std::vector<float> m_d;
+		std::vector<float> m_y[MAX_MICROPHONES];
 		float m_bm[MAX_MICROPHONES][BM_N];
 		float m_mc[MAX_MICROPHONES][MC_L];
 	};
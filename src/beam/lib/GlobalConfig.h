@@ -2,8 +2,11 @@
 #define GLOBALCONFIG_H_
 
 namespace Beam{
+// default frame size. a Pipeline can use 2^n, 5 * 2^n or 15 * 2^n samples from MIN_FRAME_SIZE to MAX_FRAME_SIZE.
 #define FRAME_SIZE 256
 #define TWO_FRAME_SIZE 512
+#define MIN_FRAME_SIZE 128
+#define MAX_FRAME_SIZE 1024
 #define AVALABLE_MICROPHONES 4
 #define MAX_MICROPHONES 4
 #define MAX_BEAMS 11
@@ -1,14 +1,9 @@
 #include "MCLT.h"
 
 namespace Beam{
-	MCLT::MCLT() : m_coeff(sqrtf(2.f / (float)FRAME_SIZE) / 2.f){
+	MCLT::MCLT(int frame_size) : m_frame_size(frame_size), m_plan(2 * frame_size){
 		/// reference: A Modulated Complex Lapped Transform and its Applications to Audio Processing, Malvar, 99
-		int two_frame_size = 2 * FRAME_SIZE;
-		for (int i = 0; i < two_frame_size; ++i){
-			m_ha[i] = sinf((0.5f + i) * (float)PI / two_frame_size);
-			m_prev_prev[i] = 0.f;
-			m_prev[i] = 0.f;
-		}
+		m_overlap.assign(frame_size, 0.f);
 	}
 
 	MCLT::~MCLT(){
@@ -19,234 +14,227 @@ namespace Beam{
 	// The windowing function must be strict sine window in this implementation
 	// Reference: Fast Algorithm for the Modulated Complex Lapped Transform, Henrique S. Malvar, Technical Report, MSR-TR-2005-2
 	// 
-	// The output coefficient is arrange as below in case of DFT_COEFF_ORDER_AEC
-	//      MCLT[0].re     --> AECFFTOut[0]
-	//      MCLT[1].re     --> AECFFTOut[1]
-	//        ...                ...
-	//      MCLT[N/2-1].re --> AECFFTOut[N/2-1]
-	//              0      --> AECFFTOut[N/2]
-	//      MCLT[N/2-1].im --> AECFFTOut[N/2+1]
+	// The output is interleaved complex, uFFTSize/2 coefficients:
+	//      MCLT[0].re     --> pOutput[0]
+	//      MCLT[0].im     --> pOutput[1]
+	//      MCLT[1].re     --> pOutput[2]
 	//        ...                ...
-	//      MCLT[2].im     --> AECFFTOut[N-2]
-	//      MCLT[1].im     --> AECFFTOut[N-1]
+	//      MCLT[N/2-1].im --> pOutput[N-1]
+	//
+	// The FFT is read in DFT_COEFF_ORDER_AEC, so neither the FFT nor the mapping re-orders the coefficients.
 	//
-	// Note that MCLT[0].im is lost
+	// Frame phase: MCLT[k], k >= 1, is multiplied by exp(-i * pi * phase * (k + 1/2)). The factor is folded
+	// into the modulation table of the phase, V[m] * conj(psi[m]) with psi[k + 1] the factor of MCLT[k], which
+	// turns the mapping into MCLT[k] = g * (V[k + 1] + (-1)^phase * i * V[k]). MCLT[0] is not compensated.
 	//
 	// Buffer behavior: Input and output buffers can be same. If they are different, the input buffer data will not be changed. 
-	void MCLT::AecCcsFwdMclt(float* pInput, float* pOutput, bool coeffOrder){
-		int k, n, uFFTSize;
-		float  r0, r1, i0, i1, ca, sa, uL, g;
-		float  *up, tm, tp, cstep, sstep;
+	void MCLT::AecCcsFwdMclt(FFTPlan& plan, float* pInput, float* pOutput, int phase){
+		int k, m, n, uFFTSize;
+		float  g, sign;
 		float  * u;
+		float  * vr, * vi;
 		float  * y;
+		const float * mc = plan.mclt_cos(phase);
+		const float * ms = plan.mclt_sin(phase);
 
-		float pfTempOut[FRAME_SIZE * 4];
-		uFFTSize = FRAME_SIZE * 2;
+		float * pfTempOut = plan.scratch(0);
+		uFFTSize = plan.size();
 
 		/* First compute FFT of input */
-		// DFT_COEFF_ORDER_NRM has output with length of  FFTSize+2;
-		FFT::AecCcsFwdFFT(pInput, pfTempOut, false);
+		FFT::AecCcsFwdFFT(plan, pInput, pfTempOut, true);
 
 		/* Get the size of the MCLT */
 		n = uFFTSize / 2;
-		u = pfTempOut;   // input of mapping at size of uFFTSize*2
+		u = pfTempOut;   // X[0], Xr[1], ..., X[n], Xi[n-1], ..., Xi[1]
+		vr = plan.scratch(1);  // modulated DFT V[m] = X[m] * exp(-i * (pi / 4 + m * step)), m = 0 ... n
+		vi = vr + n + 1;
 		y = pOutput;    // output of mapping at size of uFFTSize
 
-		/* Now apply DFT-to-MCLT mapping */
-		uL = 0.5f / n;
-		g = (float)(PI * (0.5f + uL));
-		cstep = cosf(g);
-		sstep = sinf(g);
-		g = sqrtf(uL);
-		ca = (float)cos(PI / 4.0);
-		sa = -ca;
-		r0 = u[0] * ca;
-		i0 = u[0] * sa;
-		up = &u[2];
-		for (k = 0; k < n - 1; k++){
-			r1 = *up++;
-			i1 = *up++;
-			tm = ca * cstep + sa * sstep;
-			sa = sa * cstep - ca * sstep;
-			ca = tm;
-			tp = ca * r1 - sa * i1;
-			i1 = sa * r1 + ca * i1;
-			r1 = tp;
-			y[k * 2] = g * (r1 - i0);
-			y[k * 2 + 1] = g * (i1 + r0);
-			r0 = r1; i0 = i1;
+		/* Now apply DFT-to-MCLT mapping, MCLT[k] = g * (V[k + 1] + sign * i * V[k]) */
+		g = sqrtf(0.5f / n);
+		sign = (phase & 1) ? -1.f : 1.f;
+		vr[0] = mc[0] * u[0];
+		vi[0] = -ms[0] * u[0];
+		for (m = 1; m < n; m++){
+			vr[m] = mc[m] * u[m] + ms[m] * u[uFFTSize - m];
+			vi[m] = mc[m] * u[uFFTSize - m] - ms[m] * u[m];
 		}
-		tm = ca * cstep + sa * sstep;
-		sa = sa * cstep - ca * sstep;
-		ca = tm;
-		y[n * 2 - 2] = g * (ca * u[n * 2] - i0);
-		y[n * 2 - 1] = g * (sa * u[n * 2] + r0);
-		// re-oder the output for DFT_COEFF_ORDER_AEC
-		if (coeffOrder)
-		{
-//			memcpy_s(pfTempOut, sizeof(float)*uFFTSize, pOutput, sizeof(float)*uFFTSize);
-			memcpy(pfTempOut, pOutput, sizeof(float)*uFFTSize);
-			pOutput[0] = pfTempOut[0];
-			for (k = 1; k<uFFTSize / 2; k++)
-			{
-				pOutput[k] = pfTempOut[k * 2];
-				pOutput[uFFTSize - k] = pfTempOut[k * 2 + 1];
-			}
-			pOutput[uFFTSize / 2] = 0;
+		vr[n] = mc[n] * u[n];
+		vi[n] = -ms[n] * u[n];
+		for (k = 0; k < n; k++){
+			y[k * 2] = g * (vr[k + 1] - sign * vi[k]);
+			y[k * 2 + 1] = g * (vi[k + 1] + sign * vr[k]);
 		}
+		if (phase & 3)
+			FwdMcltFirstBin(plan, u[0], u[1], u[uFFTSize - 1], y);
 	}
 
-	// Fast inverse MCLT implementation vis FFT
-	// The windowing function must be strict sine window in this implementation
-	// Reference: Fast Algorithm for the Modulated Complex Lapped Transform, Henrique S. Malvar, Technical Report, MSR-TR-2005-2
-	// 
-	// Buffer behavior: Input and output buffers can be same. If they are different, the input buffer data will not be changed. 
-	void MCLT::AecCcsInvMclt(float * pInput, float * pOutput, bool coeffOrder)
+	// MCLT[0] without the phase compensation, from X[0], Xr[1] and Xi[1].
+	void MCLT::FwdMcltFirstBin(FFTPlan& plan, float x0, float xr1, float xi1, float* y)
 	{
-		int      k, n, j, uFFTSize;
-		float   r1, i1, ca, sa, uL, g;
-		float   tm, cstep, sstep;
-		float   *y, *t;
-		float   fltScale = 0.0f;
-
-		float pfTempMCLTIn[FRAME_SIZE * 4];
-		float pfTempFFTIn[FRAME_SIZE * 4];
-		uFFTSize = FRAME_SIZE * 2;
+		const float * mc = plan.mclt_cos();
+		const float * ms = plan.mclt_sin();
+		float g = sqrtf(0.5f / (plan.size() / 2));
+		float r0 = mc[0] * x0;
+		float i0 = -ms[0] * x0;
+		float r1 = mc[1] * xr1 + ms[1] * xi1;
+		float i1 = mc[1] * xi1 - ms[1] * xr1;
+		y[0] = g * (r1 - i0);
+		y[1] = g * (i1 + r0);
+	}
+	// Forward MCLT of all channels at once. Same mapping as AecCcsFwdMclt, applied to the
+	// channel-interleaved output of AecCcsFwdFFTBatch, so each modulation entry is loaded once
+	// for all channels. The coefficients are written to their final position,
+	// the interleaved complex spectrum of each channel.
+	//
+	// Buffer behavior: the input buffer data will not be changed. 
+	void MCLT::AecCcsFwdMcltBatch(FFTPlan& plan, float* pInput, float* const* pOutput, int phase){
+		int k, n, c, uFFTSize, C;
+		float  g, sign;
+		float  * s;
+		float  * r0, * i0;
+		const float * mc = plan.mclt_cos(phase);
+		const float * ms = plan.mclt_sin(phase);
+
+		uFFTSize = plan.size();
+		C = plan.channels();
+		s = plan.scratch(0);   // channel-interleaved FFT output, uFFTSize * C
+		r0 = plan.scratch(1);  // previous coefficient of each channel
+		i0 = r0 + C;
+
+		/* First compute FFT of input, packing channel pairs if the plan asks for it */
+		if (plan.packed())
+			FFT::AecCcsFwdFFTPacked(plan, pInput, s);
+		else
+			FFT::AecCcsFwdFFTBatch(plan, pInput, s);
 
 		/* Get the size of the MCLT */
 		n = uFFTSize / 2;
 
-		// re-order input to normal order
-		if (coeffOrder)
-		{
-			pfTempMCLTIn[0] = pInput[0];
-			pfTempMCLTIn[1] = 0;
-			for (k = 1; k < n; k++)
-			{
-				pfTempMCLTIn[k * 2] = pInput[k];
-				pfTempMCLTIn[k * 2 + 1] = pInput[uFFTSize - k];
+		/* Now apply DFT-to-MCLT mapping */
+		g = sqrtf(0.5f / n);
+		sign = (phase & 1) ? -1.f : 1.f;
+		for (c = 0; c < C; c++){
+			r0[c] = s[c] * mc[0];
+			i0[c] = -s[c] * ms[0];
+		}
+		for (k = 0; k < n - 1; k++){
+			// Xr[k + 1] and Xi[k + 1] of every channel
+			const float * sr = s + (k + 1) * C;
+			const float * si = s + (uFFTSize - k - 1) * C;
+			const float ca = mc[k + 1];
+			const float sa = ms[k + 1];
+			for (c = 0; c < C; c++){
+				float r1 = ca * sr[c] + sa * si[c];
+				float i1 = ca * si[c] - sa * sr[c];
+				float * y = pOutput[c];
+				y[k * 2] = g * (r1 - sign * i0[c]);
+				y[k * 2 + 1] = g * (i1 + sign * r0[c]);
+				r0[c] = r1; i0[c] = i1;
 			}
-			y = pfTempMCLTIn;
 		}
-		else{
-			y = pInput;
+		for (c = 0; c < C; c++){
+			float * y = pOutput[c];
+			float un = s[n * C + c];
+			y[n * 2 - 2] = g * (mc[n] * un - sign * i0[c]);
+			y[n * 2 - 1] = g * (-ms[n] * un + sign * r0[c]);
+			if (phase & 3)
+				FwdMcltFirstBin(plan, s[c], s[C + c], s[(uFFTSize - 1) * C + c], y);
 		}
+	}
 
-		t = pfTempFFTIn;
+	// IMCLT-to-IDFT mapping of the inverse MCLT. The input is interleaved complex as the output of
+	// AecCcsFwdMclt. Returns the DFT in DFT_COEFF_ORDER_AEC, in plan.scratch(1), ready for the inverse FFT.
+	// Only the coefficients 0 ... N/2 are computed, the others are their conjugates.
+	//
+	// Frame phase: MCLT[k], k >= 1, is first multiplied by exp(i * pi * phase * (k + 1/2)), which undoes the
+	// compensation of the forward MCLT. With the table of the phase this is
+	// T[k] = (MCLT[k - 1] - (-1)^phase * i * MCLT[k]) * table[k] for k >= 2. T[1] and T[n] are computed apart.
+	float * MCLT::InvMcltMapping(FFTPlan& plan, float * pInput, int phase)
+	{
+		int      k, n, uFFTSize;
+		float   r1, i1, sign;
+		float   *y, *t;
+		const float * mc = plan.mclt_cos(phase);
+		const float * ms = plan.mclt_sin(phase);
+
+		uFFTSize = plan.size();
+		y = pInput;
+		t = plan.scratch(1);
 
-		/* Apply IMCLT-to-IDFT mapping */
-		uL = 0.5f / n;
-		g = (float)(PI * (0.5f + uL));
-		cstep = cosf(g);
-		sstep = sinf(-g);
+		/* Get the size of the MCLT */
+		n = uFFTSize / 2;
 
-		g = sqrtf(uL);
-		ca = (float)cos(PI / 4.0);
-		sa = ca;
+		/* Apply IMCLT-to-IDFT mapping, T[k] = (MCLT[k - 1] - i * MCLT[k]) * exp(i * (pi / 4 + k * step)) */
+		sign = (phase & 1) ? -1.f : 1.f;
 		for (k = 1; k < n; k++)
 		{
-			r1 = y[k * 2 + 1] + y[k * 2 - 2];
-			i1 = y[k * 2 - 1] - y[k * 2];
-			tm = ca * cstep + sa * sstep;
-			sa = sa * cstep - ca * sstep;
-			ca = tm;
-			t[k * 2] = ca * r1 - sa * i1;
-			t[k * 2 + 1] = sa * r1 + ca * i1;
+			r1 = sign * y[k * 2 + 1] + y[k * 2 - 2];
+			i1 = y[k * 2 - 1] - sign * y[k * 2];
+			t[k] = mc[k] * r1 - ms[k] * i1;
+			t[uFFTSize - k] = ms[k] * r1 + mc[k] * i1;
 		}
 		t[0] = sqrtf(2.f) * (y[0] + y[1]);
-		t[1] = 0.f;
-		t[n * 2] = -sqrtf(2.f) * (y[n * 2 - 2] + y[n * 2 - 1]);
-		t[n * 2 + 1] = 0.f;
-		k = n - 1;
-		for (j = n + 1; j < 2 * n; j++)
+		t[n] = -sqrtf(2.f) * (y[n * 2 - 2] + y[n * 2 - 1]);
+		if (phase & 3)
 		{
-			t[j * 2] = t[k * 2];
-			t[j * 2 + 1] = -t[k * 2 + 1];
-			k--;
+			// MCLT[k] * exp(i * pi * phase * (k + 1/2)) = MCLT[k] * j^phase * (-1)^(phase * k)
+			static const float jr[4] = { 1.f, 0.f, -1.f, 0.f };
+			static const float ji[4] = { 0.f, 1.f, 0.f, -1.f };
+			const float * mc0 = plan.mclt_cos();
+			const float * ms0 = plan.mclt_sin();
+			float cr = jr[phase & 3] * sign, ci = ji[phase & 3] * sign;   // factor of MCLT[1]
+			float yr = cr * y[2] - ci * y[3];
+			float yi = ci * y[2] + cr * y[3];
+			r1 = yi + y[0];
+			i1 = y[1] - yr;
+			t[1] = mc0[1] * r1 - ms0[1] * i1;
+			t[uFFTSize - 1] = ms0[1] * r1 + mc0[1] * i1;
+			if ((phase & 1) && (n & 1))
+			{
+				cr = -cr; ci = -ci;   // factor of MCLT[n - 1] = factor of MCLT[1] * (-1)^(phase * (n - 2))
+			}
+			yr = cr * y[n * 2 - 2] - ci * y[n * 2 - 1];
+			yi = ci * y[n * 2 - 2] + cr * y[n * 2 - 1];
+			t[n] = -sqrtf(2.f) * (yr + yi);
 		}
 
-		FFT::AecCcsInvFFT(pfTempFFTIn, pOutput, false);
+		return t;
+	}
 
-		fltScale = 1.f / sqrtf(32.f * n);
+	// Fast inverse MCLT implementation vis FFT
+	// The windowing function must be strict sine window in this implementation
+	// Reference: Fast Algorithm for the Modulated Complex Lapped Transform, Henrique S. Malvar, Technical Report, MSR-TR-2005-2
+	// 
+	// Buffer behavior: Input and output buffers can be same. If they are different, the input buffer data will not be changed. 
+	void MCLT::AecCcsInvMclt(FFTPlan& plan, float * pInput, float * pOutput, int phase)
+	{
+		int j, uFFTSize;
+		float fltScale;
+
+		uFFTSize = plan.size();
+		FFT::AecCcsInvFFT(plan, InvMcltMapping(plan, pInput, phase), pOutput, true);
+
+		fltScale = 1.f / sqrtf(16.f * uFFTSize);
 		for (j = 0; j < uFFTSize; j++)
 		{
 			pOutput[j] *= fltScale;
 		}
 	}
 
-	//void MCLT::analyze(std::vector<float>& input, std::vector<std::complex<float> >& output){
-	//	int m_half = FRAME_SIZE / 2;
-	//	int m_three_halves = 3 * m_half;
-	//	float t = 0.f;
-	//	for (int n = 0; n < FRAME_SIZE; ++n){
-	//		m_u[n] = m_ha[m_half + n] * input[m_three_halves - n - 1];
-	//	}
-	//	std::copy(m_u, m_u + FRAME_SIZE, m_v);
-	//	for (int n = 0; n < m_half; ++n){
-	//		t = m_ha[m_half - 1 - n] * input[m_three_halves + n];
-	//		m_u[n] += t;
-	//		m_v[n] -= t;
-	//	}
-	//	for (int n = 0; n < m_half; ++n){
-	//		t = m_ha[n] * input[n];
-	//		m_u[n + m_half] -= t;
-	//		m_v[n + m_half] += t;
-	//	}
-	//	// compute DCT and DST
-	//	fftwf_plan p;
-	//	p = fftwf_plan_r2r_1d(FRAME_SIZE, m_u, m_u, FFTW_REDFT11, FFTW_ESTIMATE);
-	//	fftwf_execute(p);
-	//	fftwf_destroy_plan(p);
-	//	p = fftwf_plan_r2r_1d(FRAME_SIZE, m_v, m_v, FFTW_RODFT11, FFTW_ESTIMATE);
-	//	fftwf_execute(p);
-	//	fftwf_destroy_plan(p);
-	//	// copy to output
-	//	for (int n = 0; n < FRAME_SIZE; ++n){
-	//		output[n].real(m_u[n] * m_coeff);
-	//		output[n].imag(m_v[n] * m_coeff);
-	//	}
-	//}
-
-	//void MCLT::synthesize(std::vector<std::complex<float> >& input, std::vector<float>& output){
-	//	int m_half = FRAME_SIZE / 2;
-	//	int m_three_halves = 3 * m_half;
-	//	int m_twice = FRAME_SIZE * 2;
-	//	for (int i = 0; i < FRAME_SIZE; ++i){
-	//		m_u[i] = input[i].real();
-	//		m_v[i] = input[i].imag();
-	//	}
-	//	// compute DCT and DST
-	//	fftwf_plan p;
-	//	p = fftwf_plan_r2r_1d(FRAME_SIZE, m_u, m_u, FFTW_REDFT11, FFTW_ESTIMATE);
-	//	fftwf_execute(p);
-	//	fftwf_destroy_plan(p);
-	//	p = fftwf_plan_r2r_1d(FRAME_SIZE, m_v, m_v, FFTW_RODFT11, FFTW_ESTIMATE);
-	//	fftwf_execute(p);
-	//	fftwf_destroy_plan(p);
-	//	for (int i = 0; i < m_half; ++i){
-	//		m_current[i] = m_ha[i] * (m_v[m_half + i] - m_u[m_half + i]);
-	//	}
-	//	for (int i = m_half; i < m_three_halves; ++i){
-	//		m_current[i] = m_ha[i] * (m_u[m_three_halves - i - 1] + m_v[m_three_halves - i - 1]);
-	//	}
-	//	for (int i = m_three_halves; i < m_twice; ++i){
-	//		m_current[i] = m_ha[i] * (m_u[i - m_three_halves] - m_v[i - m_three_halves]);
-	//	}
-	//	for (int i = 0; i < m_twice; ++i){
-	//		m_current[i] *= 0.5f * m_coeff;
-	//	}
-	//	// first half
-	//	for (int i = 0; i < FRAME_SIZE; ++i){
-	//		output[i] = m_prev_prev[i + FRAME_SIZE] + m_prev[i];
-	//	}
-	//	// second half
-	//	for (int i = FRAME_SIZE; i < m_twice; ++i){
-	//		output[i] = m_current[i - FRAME_SIZE] + m_prev[i];
-	//	}
-	//	// copy to prev prev
-	//	memcpy(m_prev_prev, m_prev, m_twice * sizeof(float));
-	//	// copy to prev
-	//	memcpy(m_prev, m_current, m_twice * sizeof(float));
-	//}
-}
+	// Same as AecCcsInvMclt followed by the overlap-add of the two halves of consecutive frames,
+	// with the scaling and the overlap-add fused into the last pass of the inverse FFT.
+	void MCLT::AecCcsInvMcltOverlapAdd(FFTPlan& plan, float * pInput, float * pOverlap, float * pOutput, int phase)
+	{
+		float fltScale = 1.f / sqrtf(16.f * plan.size());
+		FFT::AecCcsInvFFTOverlapAdd(plan, InvMcltMapping(plan, pInput, phase), true, fltScale, NULL, pOverlap, pOutput);
+	}
+
+	void MCLT::analyze(const float* input, std::complex<float>* output){
+		AecCcsFwdMclt(m_plan, const_cast<float*>(input), reinterpret_cast<float*>(output));
+	}
 
+	void MCLT::synthesize(const std::complex<float>* input, float* output){
+		AecCcsInvMcltOverlapAdd(m_plan, reinterpret_cast<float*>(const_cast<std::complex<float>*>(input)), &m_overlap[0], output);
+	}
+}
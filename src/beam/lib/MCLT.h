@@ -9,29 +9,37 @@ namespace Beam{
 	class MCLT {
 	public:
 		/// constructor with the size.
-		MCLT();
+		MCLT(int frame_size = FRAME_SIZE);
 		~MCLT();
-		/// compute MCLT. make sure that output is allocated.
-		/// the input must have 2 * FRAME_SIZE.
-		/// the output must have FRAME_SIZE.
-		void analyze(std::vector<float>& input, std::vector<std::complex<float> >& output);
-		/// compute IMCLT. make sure that output is allocated.
-		/// the input must have FRAME_SIZE.
-		/// the output must have 2 * FRAME_SIZE.
-		/// the output has half frame delay.
-		void synthesize(std::vector<std::complex<float> >& input, std::vector<float>& output);
+		/// compute MCLT of one frame, working on the caller's buffers.
+		/// the input has 2 * frame_size samples, the previous frame followed by the current one. it is not changed.
+		/// the output receives frame_size bins.
+		void analyze(const float* input, std::complex<float>* output);
+		/// compute IMCLT of one frame with overlap-add.
+		/// the input has frame_size bins, the output receives frame_size samples.
+		/// the output lags the newest input frame by one frame.
+		void synthesize(const std::complex<float>* input, float* output);
 
-		static void AecCcsFwdMclt(float* pInput, float* pOutput, bool coeffOrder);
-		static void AecCcsInvMclt(float * pInput, float * pOutput, bool coeffOrder);
+		/// the plan must have twice the frame size. the input has plan.size() samples,
+		/// the spectrum has plan.size() / 2 bins, interleaved complex (re, im) like std::complex<float>.
+		/// phase is the frame number & 3. the forward MCLT multiplies bin k >= 1 by exp(-i * pi * phase * (k + 1/2)),
+		/// which compensates the phase advance of the bins from frame to frame. the inverse MCLT undoes it.
+		static void AecCcsFwdMclt(FFTPlan& plan, float* pInput, float* pOutput, int phase = 0);
+		static void AecCcsInvMclt(FFTPlan& plan, float * pInput, float * pOutput, int phase = 0);
+		/// AecCcsInvMclt with the overlap-add of consecutive frames fused into the inverse fft.
+		/// pOutput receives plan.size() / 2 samples, pOverlap holds the second half of the previous frame
+		/// and receives that of this one.
+		static void AecCcsInvMcltOverlapAdd(FFTPlan& plan, float * pInput, float * pOverlap, float * pOutput, int phase = 0);
+		/// forward MCLT of the plan.channels() channels at once.
+		/// pInput is channel-interleaved: pInput[n * plan.channels() + channel], n < plan.size().
+		/// pOutput[channel] receives the spectrum of that channel, in the layout of AecCcsFwdMclt.
+		static void AecCcsFwdMcltBatch(FFTPlan& plan, float* pInput, float* const* pOutput, int phase = 0);
 	private:
-		float m_coeff;
-		float m_input[FRAME_SIZE * 2];
-		float m_ha[FRAME_SIZE * 2];
-		float m_prev_prev[FRAME_SIZE * 2];
-		float m_prev[FRAME_SIZE * 2];
-		float m_current[FRAME_SIZE * 2];
-		float m_u[FRAME_SIZE];
-		float m_v[FRAME_SIZE];
+		static float * InvMcltMapping(FFTPlan& plan, float * pInput, int phase);
+		static void FwdMcltFirstBin(FFTPlan& plan, float x0, float xr1, float xi1, float* y);
+		int m_frame_size;
+		FFTPlan m_plan;
+		std::vector<float> m_overlap;
 	};
 }
 
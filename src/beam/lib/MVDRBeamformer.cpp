@@ -1,50 +1,64 @@
 #include "MVDRBeamformer.h"
+#include <cmath>
 
 namespace Beam {
-MVDRBeamformer::MVDRBeamformer() {
-	m_nn.assign(FRAME_SIZE, Eigen::Matrix<std::complex<float>, MAX_MICROPHONES, MAX_MICROPHONES>::Identity());
+MVDRBeamformer::MVDRBeamformer() : m_steering(SteeringVectors::get(FRAME_SIZE)) {
+	m_nn.assign(FRAME_SIZE, Matrix::Identity());
+	m_nn_inv.assign(FRAME_SIZE, Matrix::Identity());
+	m_invertible.assign(FRAME_SIZE, 1);
+	m_updates = 0;
 }
 
 MVDRBeamformer::~MVDRBeamformer() {
 
 }
 
+void MVDRBeamformer::invert(int bin) {
+	std::complex<float> determinant;
+	bool invertible;
+	m_nn[bin].computeInverseAndDetWithCheck(m_nn_inv[bin], determinant, invertible);
+	m_invertible[bin] = invertible ? 1 : 0;
+}
+
 void MVDRBeamformer::compute(std::vector<std::complex<float> >* input,
 		std::vector<std::complex<float> >& output, float angle,
 		float confidence, double time, bool voice) {
 	if (!voice) {
-		// noise frame, update noise covariance matrix
+		// noise frame, update noise covariance matrix: R' = a * R + b * n * n^H with a = MVDR_FORGETTING, b = 1 - a.
+		// with c = b / a, v = R^-1 * n and den = 1 + c * n^H * v the inverse is
+		// R'^-1 = (R^-1 - c / den * v * v^H) / a. the slice of bins due for the periodic inversion is inverted instead.
+		const float a = MVDR_FORGETTING;
+		const float c = (1.f - a) / a;
+		const int slice = m_updates % MVDR_REINVERSION_PERIOD;
 		for (int bin = 0; bin < FRAME_SIZE; ++bin) {
-			Eigen::Matrix<std::complex<float>, MAX_MICROPHONES, 1> n;
+			Vector n;
 			for (int i = 0; i < MAX_MICROPHONES; ++i) {
 				n(i, 0) = input[i][bin];
 			}
-			Eigen::Matrix<std::complex<float>, MAX_MICROPHONES, MAX_MICROPHONES> nn = n * n.adjoint();
-			m_nn[bin] = m_nn[bin] * 0.99f + nn * 0.01f;
+			m_nn[bin] = m_nn[bin] * a + n * n.adjoint() * (1.f - a);
+			if (!m_invertible[bin] || bin % MVDR_REINVERSION_PERIOD == slice) {
+				invert(bin);
+				continue;
+			}
+			Vector v = m_nn_inv[bin] * n;
+			float den = 1.f + c * (n.adjoint() * v)(0, 0).real();
+			if (!(den > 0.f) || !std::isfinite(den)) {
+				invert(bin);
+				continue;
+			}
+			m_nn_inv[bin] = (m_nn_inv[bin] - v * v.adjoint() * (c / den)) / a;
 		}
+		++m_updates;
 	}
-	// compute time delay
+	const std::complex<float>* steering = m_steering.vector(angle);
 	for (int bin = 0; bin < FRAME_SIZE; ++bin) {
-		Eigen::Matrix<std::complex<float>, MAX_MICROPHONES, MAX_MICROPHONES> inverse;
-		std::complex<float> determinant;
-		bool invertible;
-		m_nn[bin].computeInverseAndDetWithCheck(inverse,determinant,invertible);
-		if (invertible) {
-			float time_delay[MAX_MICROPHONES] = { 0.f };
-			for (int channel = 0; channel < MAX_MICROPHONES; ++channel) {
-				float distance = KinectConfig::kinect_descriptor.mic[channel].y
-						* sinf(angle);
-				time_delay[channel] = distance / (float) SOUND_SPEED;
-			}
-			Eigen::Matrix<std::complex<float>, MAX_MICROPHONES, 1> d_h;
-			float rad_freq = (float) (-bin * TWO_PI * SAMPLE_RATE / FRAME_SIZE
-					/ 2.f);
+		if (m_invertible[bin]) {
+			Vector d_h;
 			for (int i = 0; i < MAX_MICROPHONES; ++i) {
-				float angle = rad_freq * time_delay[i];
-				d_h(i, 0) = std::complex<float>(cosf(angle), sinf(angle));
+				d_h(i, 0) = steering[bin * MAX_MICROPHONES + i];
 			}
 			Eigen::Matrix<std::complex<float>, 1, MAX_MICROPHONES> d = d_h.adjoint();
-			Eigen::Matrix<std::complex<float>, MAX_MICROPHONES, 1> nn_inv_d_h = inverse * d_h;
+			Vector nn_inv_d_h = m_nn_inv[bin] * d_h;
 			Eigen::Matrix<std::complex<float>, 1, 1> denom_mat = d * nn_inv_d_h;
 			float denom = denom_mat(0, 0).real();
 			std::complex<float> sum(0.f, 0.f);
@@ -5,15 +5,38 @@
 #include <Eigen/LU>
 #include "KinectConfig.h"
 #include "SoundSourceLocalizer.h"
+#include "SteeringVectors.h"
 
 namespace Beam{
+// the noise covariance forgets with this factor per noise frame.
+#define MVDR_FORGETTING 0.99f
+// every bin is inverted from its covariance again after this many updates, in turns, one slice of bins per update.
+#define MVDR_REINVERSION_PERIOD 64
+
+	/// minimum variance distortionless response beamformer towards the sound source.
+	/// the noise covariance of every bin is updated on frames without voice. its inverse is kept up to date
+	/// with a Sherman-Morrison update of the same rank-1 step, so a frame costs a few matrix-vector products per bin
+	/// instead of an inversion, and frames with voice reuse the inverse as it is. the updates accumulate rounding,
+	/// so every MVDR_REINVERSION_PERIOD updates each bin is inverted from its covariance again.
+	/// the steering vectors come from the shared SteeringVectors cache.
 	class MVDRBeamformer {
 	public:
+		typedef Eigen::Matrix<std::complex<float>, MAX_MICROPHONES, MAX_MICROPHONES> Matrix;
+		typedef Eigen::Matrix<std::complex<float>, MAX_MICROPHONES, 1> Vector;
 		MVDRBeamformer();
 		~MVDRBeamformer();
 		void compute(std::vector<std::complex<float> >* input, std::vector<std::complex<float> >& output, float angle, float confidence, double time, bool voice = false);
+		/// the noise covariance of bin and its inverse, which compute uses.
+		const Matrix& covariance(int bin) const { return m_nn[bin]; }
+		const Matrix& inverse(int bin) const { return m_nn_inv[bin]; }
 	private:
-		std::vector<Eigen::Matrix<std::complex<float>, MAX_MICROPHONES, MAX_MICROPHONES> > m_nn;
+		// inverse of the covariance of bin. bins that are not invertible keep their previous output.
+		void invert(int bin);
+		std::vector<Matrix> m_nn;
+		std::vector<Matrix> m_nn_inv;
+		std::vector<char> m_invertible;
+		int m_updates; // noise frames so far, selects the bins to invert again.
+		const SteeringVectors& m_steering;
 	};
 }
 
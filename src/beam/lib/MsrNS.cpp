@@ -1,20 +1,16 @@
 #include "MsrNS.h"
 
 namespace Beam{
-	MsrNS::MsrNS()
+	MsrNS::MsrNS(int frame_size) : m_frame_size(frame_size)
 	{
-		std::fill(piPriorSNR, piPriorSNR + FRAME_SIZE, 1.f);
-		std::fill(piGain, piGain + FRAME_SIZE, 1.f);
-		std::fill(piPosteriorSNR_NS, piPosteriorSNR_NS + FRAME_SIZE, 0.f);
-		std::fill(piMLPriorSNR_NS, piMLPriorSNR_NS + FRAME_SIZE, 0.f);
-		std::fill(piPriorSNR_NS, piPriorSNR_NS + FRAME_SIZE, 0.f);
+		piPriorSNR.assign(frame_size, 1.f);
+		piGain.assign(frame_size, 1.f);
+		piPosteriorSNR_NS.assign(frame_size, 0.f);
+		piMLPriorSNR_NS.assign(frame_size, 0.f);
+		piPriorSNR_NS.assign(frame_size, 0.f);
 	}
 
-	MsrNS::~MsrNS()
-	{
-	}
-
-	void MsrNS::process(float* fft_ptr, MsrVAD* pVAD, bool enableNS){
+	void MsrNS::process(std::complex<float>* spectrum, MsrVAD* pVAD, bool enableNS){
 		int* pMasterSpeechPresenceProb = pVAD->GetMasterSpeechPresenceProbQ30();
 		float* pMasterSignalPowerOverNoiseModel = pVAD->GetMasterSignalPowerOverNoiseModel();
 
@@ -69,8 +65,7 @@ namespace Beam{
 			// Apply the gain to pSpec
 			if (enableNS)
 			{
-				fft_ptr[i] *= fGain;                 // Re
-				fft_ptr[TWO_FRAME_SIZE - i] *= fGain;
+				spectrum[i] *= fGain;
 			}
 
 			// Update gain for next frame
@@ -19,17 +19,18 @@ namespace Beam{
 	class MsrNS
 	{
 	public:
-		MsrNS();
-		~MsrNS();
-		void process(float* fft_ptr, MsrVAD* pVAD, bool enableNS);
+		/// frame_size is the number of bins of a frame.
+		MsrNS(int frame_size = FRAME_SIZE);
+		/// spectrum has frame_size bins, the gains are applied in place.
+		void process(std::complex<float>* spectrum, MsrVAD* pVAD, bool enableNS);
 	private:
-
-		float piPriorSNR[FRAME_SIZE];
-		float piGain[FRAME_SIZE];
+		int m_frame_size;
+		std::vector<float> piPriorSNR;
+		std::vector<float> piGain;
 		// Scratch space
-		float piPosteriorSNR_NS[FRAME_SIZE];
-		float piMLPriorSNR_NS[FRAME_SIZE];
-		float piPriorSNR_NS[FRAME_SIZE];
+		std::vector<float> piPosteriorSNR_NS;
+		std::vector<float> piMLPriorSNR_NS;
+		std::vector<float> piPriorSNR_NS;
 	};
 }
 
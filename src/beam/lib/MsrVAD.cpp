@@ -1,7 +1,7 @@
 #include "MsrVAD.h"
 
 namespace Beam{
-	MsrVAD::MsrVAD()
+	MsrVAD::MsrVAD(int frame_size) : m_frame_size(frame_size)
 	{
 		m_VAD_TAUN = 0.4f;
 		m_VAD_TAUS = 2.681769f;
@@ -10,23 +10,22 @@ namespace Beam{
 		m_VAD_A10 = 0.99f;
 		m_VAD_A01f = 0.01f;
 		m_VAD_A10f = 0.870009f;
-		m_MecBegBin = std::max(2, (int)(200 * (SAMPLE_RATE / 1000) / FRAME_SIZE / 2));
-		m_MecEndBin = std::min(FRAME_SIZE - 1, (int)(7200 * (SAMPLE_RATE / 1000) / FRAME_SIZE / 2));
-		m_MecFrameDuration = ((float)FRAME_SIZE / SAMPLE_RATE);
-
-		m_LogLikelihoodBegBin = 0.045f * FRAME_SIZE;
-		m_LogLikelihoodEndBin = 0.65f * FRAME_SIZE;
-
-		std::fill(q30MasterSpeechPresenceProb, q30MasterSpeechPresenceProb + FRAME_SIZE, 0);
-		std::fill(MasterSignalPowerOverNoiseModel, MasterSignalPowerOverNoiseModel + FRAME_SIZE, 0.f);
-		std::fill(priorSNR, priorSNR + FRAME_SIZE, 0.f);
-		std::fill(posteriorSNR_NS, posteriorSNR_NS + FRAME_SIZE, 0.f);
-		std::fill(speechPresenceLR, speechPresenceLR + FRAME_SIZE, 0.f);
-		std::fill(speechPresenceProb, speechPresenceProb + FRAME_SIZE, 0.f);
-		std::fill(SpeechModel, SpeechModel + FRAME_SIZE, 1.f);
-		std::fill(NoiseModel, NoiseModel + FRAME_SIZE, 0.f);
-		std::fill(SignalSpecIn, SignalSpecIn + 2 * FRAME_SIZE, 0.f);
-		std::fill(SignalPower, SignalPower + FRAME_SIZE, 0.f);
+		m_MecBegBin = std::max(2, (int)(200 * (SAMPLE_RATE / 1000) / frame_size / 2));
+		m_MecEndBin = std::min(frame_size - 1, (int)(7200 * (SAMPLE_RATE / 1000) / frame_size / 2));
+		m_MecFrameDuration = ((float)frame_size / SAMPLE_RATE);
+
+		m_LogLikelihoodBegBin = 0.045f * frame_size;
+		m_LogLikelihoodEndBin = 0.65f * frame_size;
+
+		q30MasterSpeechPresenceProb.assign(frame_size, 0);
+		MasterSignalPowerOverNoiseModel.assign(frame_size, 0.f);
+		priorSNR.assign(frame_size, 0.f);
+		posteriorSNR_NS.assign(frame_size, 0.f);
+		speechPresenceLR.assign(frame_size, 0.f);
+		speechPresenceProb.assign(frame_size, 0.f);
+		SpeechModel.assign(frame_size, 1.f);
+		NoiseModel.assign(frame_size, 0.f);
+		SignalPower.assign(frame_size, 0.f);
 
 		FrameLR = 0.0f;
 		m_fFramePresProb = 0;
@@ -35,22 +34,7 @@ namespace Beam{
 		m_fSNR = 1.0f;
 	}
 
-	MsrVAD::~MsrVAD()
-	{
-	}
-
-	void MsrVAD::process(std::vector<std::complex<float> >& input){
-		float fft_ptr[TWO_FRAME_SIZE];
-		fft_ptr[0] = input[0].real();
-		fft_ptr[FRAME_SIZE] = 0.f;
-		for (int i = 1; i < FRAME_SIZE; ++i){
-			fft_ptr[i] = input[i].real();
-			fft_ptr[TWO_FRAME_SIZE - i] = input[i].imag();
-		}
-		process(fft_ptr);
-	}
-
-	void MsrVAD::process(float* fft_ptr){
+	void MsrVAD::process(const std::complex<float>* spectrum){
 		const float a00 = 1.0f - m_VAD_A01;
 		const float a11 = 1.0f - m_VAD_A10;
 		const float a00f = 1.0f - m_VAD_A01f;
@@ -60,8 +44,8 @@ namespace Beam{
 		float likelogmean = 0.0f;
 		for (unsigned int u = m_MecBegBin; u <= m_MecEndBin; u++) { // optimized for non-zero frequency bins
 			// calculate signal power
-			float MicRe = fft_ptr[u];
-			float MicIm = fft_ptr[TWO_FRAME_SIZE - u];
+			float MicRe = spectrum[u].real();
+			float MicIm = spectrum[u].imag();
 			SignalPower[u] = MicRe * MicRe + MicIm * MicIm;
 
 			// update the prior and posterios SNRs
@@ -13,10 +13,10 @@ namespace Beam{
 	class MsrVAD
 	{
 	public:
-		MsrVAD();
-		~MsrVAD();
-		void process(std::vector<std::complex<float> >& input);
-		void process(float* fft_ptr);
+		/// frame_size is the number of bins of a frame.
+		MsrVAD(int frame_size = FRAME_SIZE);
+		/// spectrum has frame_size bins.
+		void process(const std::complex<float>* spectrum);
 		int* GetMasterSpeechPresenceProbQ30() { return &q30MasterSpeechPresenceProb[0]; }
 		float* GetMasterSignalPowerOverNoiseModel() { return &MasterSignalPowerOverNoiseModel[0]; }
 		float GetSNR() { return m_fSNR; }
@@ -36,17 +36,17 @@ namespace Beam{
 		float  m_MecFrameDuration;
 		float m_LogLikelihoodBegBin;
 		float m_LogLikelihoodEndBin;
+		int m_frame_size;
 
-		int q30MasterSpeechPresenceProb[FRAME_SIZE];
-		float MasterSignalPowerOverNoiseModel[FRAME_SIZE];
-		float priorSNR[FRAME_SIZE];
-		float posteriorSNR_NS[FRAME_SIZE];
-		float speechPresenceLR[FRAME_SIZE]; // per bin soft VAD
-		float speechPresenceProb[FRAME_SIZE];
-		float SpeechModel[FRAME_SIZE];
-		float NoiseModel[FRAME_SIZE];
-		float SignalSpecIn[2 * FRAME_SIZE];
-		float SignalPower[FRAME_SIZE];
+		std::vector<int> q30MasterSpeechPresenceProb;
+		std::vector<float> MasterSignalPowerOverNoiseModel;
+		std::vector<float> priorSNR;
+		std::vector<float> posteriorSNR_NS;
+		std::vector<float> speechPresenceLR; // per bin soft VAD
+		std::vector<float> speechPresenceProb;
+		std::vector<float> SpeechModel;
+		std::vector<float> NoiseModel;
+		std::vector<float> SignalPower;
 
 		float FrameLR;
 		float m_fFramePresProb;
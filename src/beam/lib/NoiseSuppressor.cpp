@@ -9,10 +9,6 @@ namespace Beam{
 		init(frequency, frame_size, adaptive_tau, suppress);
 	}
 
-	NoiseSuppressor::~NoiseSuppressor(){
-
-	}
-
 	void NoiseSuppressor::init(float frequency, int frame_size, float adaptive_tau, float suppress){
 		m_frame_duration = (float)frame_size / frequency;
 		m_phase_adaptive_tau = adaptive_tau;
@@ -25,6 +21,27 @@ namespace Beam{
 
 		m_phase_num_frames = 0;
 		m_noise_num_frames = 0;
+		// the models are allocated here, so processing a frame does not allocate.
+		reset_phase_model(frame_size);
+		reset_noise_model(frame_size);
+	}
+
+	void NoiseSuppressor::reset_phase_model(int bins){
+		m_phase_model.assign(bins, std::complex<float>(0.f, 0.f));
+		m_phase_model_variance.assign(bins, 0.f);
+		m_phase_model_update.assign(bins, std::complex<float>(0.f, 0.f));
+		//  initialize it with one frame delay for each frequency
+		for (int bin = 0; bin < bins; ++bin){
+			float frequency = ((float)bin + 0.5f) * m_sampling_rate / 2.f / bins;
+			float phase = (float)(TWO_PI * m_frame_duration * frequency);
+			m_phase_model_update[bin] = std::complex<float>(cosf(phase), sinf(phase));
+		}
+		m_phase_model_prev.assign(bins, std::complex<float>(0.f, 0.f));
+	}
+
+	void NoiseSuppressor::reset_noise_model(int bins){
+		m_noise_model.assign(bins, 0.f);
+		m_noise_model_variance.assign(bins, 0.f);
 	}
 
 	void NoiseSuppressor::phase_compensation(std::vector<std::complex<float> >& output){
@@ -32,24 +49,9 @@ namespace Beam{
 		//	Prepare some constants
 		float phase_adaptive_ratio = (float)(m_frame_duration / m_phase_adaptive_tau);
 		float speed_adaptive_ratio = (float)(m_frame_duration / m_speed_adaptive_tau);
-		//  Check and create vectors
-		if (m_phase_model.empty()){
-			m_phase_model.assign(bins, std::complex<float>(0.f, 0.f));
-		}
-		if (m_phase_model_variance.empty()){
-			m_phase_model_variance.assign(bins, 0.f);
-		}
-		if (m_phase_model_update.empty()){
-			m_phase_model_update.assign(bins, std::complex<float>(0.f, 0.f));
-			//  initialize it with one frame delay for each frequency
-			for (int bin = 0; bin < bins; ++bin){
-				float frequency = ((float)bin + 0.5f) * m_sampling_rate / 2.f / bins;
-				float phase = (float)(TWO_PI * m_frame_duration * frequency);
-				m_phase_model_update[bin] = std::complex<float>(cosf(phase), sinf(phase));
-			}
-		}
-		if (m_phase_model_prev.empty()){
-			m_phase_model_prev.assign(bins, std::complex<float>(0.f, 0.f));
+		//  Check the vectors, init made them for frame_size bins.
+		if ((int)m_phase_model.size() != bins){
+			reset_phase_model(bins);
 		}
 		//  Rotate the complex phase model
 		for (int i = 0; i < bins; ++i){
@@ -113,7 +115,7 @@ namespace Beam{
 			}
 			Utils::normalize_complex(speed);
 		}
-		m_phase_model_prev.assign(output.begin(), output.end());
+		std::copy(output.begin(), output.end(), m_phase_model_prev.begin());
 		//  Compensate the phase
 		for (int i = 0; i < bins; ++i){
 			output[i] -= m_phase_model[i];
@@ -124,11 +126,8 @@ namespace Beam{
 	void NoiseSuppressor::noise_compensation(std::vector<std::complex<float> >& output){
 		int bins = (int)output.size();
 		float noise_adaptive_ratio = (float)(m_frame_duration / m_noise_adaptive_tau);
-		if (m_noise_model.empty()){
-			m_noise_model.assign(bins, 0.f);
-		}
-		if (m_noise_model_variance.empty()){
-			m_noise_model_variance.assign(bins, 0.f);
+		if ((int)m_noise_model.size() != bins){
+			reset_noise_model(bins);
 		}
 		//	Suppress the stationary noise
 		for (int i = 0; i < bins; ++i){
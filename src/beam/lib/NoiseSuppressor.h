@@ -8,13 +8,14 @@ namespace Beam{
 	public:
 		NoiseSuppressor();
 		NoiseSuppressor(float frequency, int frame_size, float adaptive_tau, float suppress);
-		~NoiseSuppressor();
 		void init(float frequency, int frame_size, float adaptive_tau, float suppress);
 		void phase_compensation(std::vector<std::complex<float> >& output);
 		void noise_compensation(std::vector<std::complex<float> >& output);
 		void frequency_shifting(std::vector<std::complex<float> >& output);
 		void set_suppress(float suppress);
 	private:
+		void reset_phase_model(int bins);
+		void reset_noise_model(int bins);
 		float m_frame_duration;
 		float m_phase_adaptive_tau;
 		float m_speed_adaptive_tau;
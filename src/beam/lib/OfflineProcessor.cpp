@@ -0,0 +1,75 @@
+#include "OfflineProcessor.h"
+#include <algorithm>
+#include <climits>
+#include <thread>
+#include "WavReader.h"
+#include "WavWriter.h"
+
+namespace Beam{
+	OfflineProcessor::OfflineProcessor(const PipelineConfig& config, int segments, int warmup) : m_config(config){
+		m_frame_size = Pipeline::supported_frame_size(config.frame_size) ? config.frame_size : FRAME_SIZE;
+		m_config.frame_size = m_frame_size;
+		m_segments = segments > 0 ? segments : std::max(1, (int)std::thread::hardware_concurrency());
+		m_warmup = warmup >= 0 ? warmup : (int)(OFFLINE_WARMUP_SECONDS * SAMPLE_RATE / m_frame_size);
+	}
+
+	long long OfflineProcessor::process_file(const std::string& input_file, const std::string& output_file){
+		long long frames = 0;
+		{
+			WavReader reader(input_file);
+			long long frame_bytes = (long long)m_frame_size * reader.get_channels() * (reader.get_bit_per_sample() / 8);
+			if (frame_bytes > 0){
+				frames = reader.get_data_size() / frame_bytes;
+			}
+		}
+		// segment s holds the frames from bounds[s] to bounds[s + 1]. short files get fewer segments.
+		int segments = (int)std::max(1LL, std::min((long long)m_segments, frames));
+		std::vector<long long> bounds(segments + 1);
+		for (int segment = 0; segment <= segments; ++segment){
+			bounds[segment] = frames * segment / segments;
+		}
+		std::vector<std::vector<short> > outputs(segments);
+		std::vector<std::thread> threads;
+		for (int segment = 0; segment < segments; ++segment){
+			threads.push_back(std::thread(&OfflineProcessor::process_segment, this, input_file, bounds[segment], bounds[segment + 1], &outputs[segment]));
+		}
+		WavWriter writer(output_file, SAMPLE_RATE, 1, 16);
+		for (int segment = 0; segment < segments; ++segment){
+			threads[segment].join();
+			if (!outputs[segment].empty()){
+				writer.write((char*)&outputs[segment][0], (int)(outputs[segment].size() * sizeof(short)));
+			}
+			std::vector<short>().swap(outputs[segment]);
+		}
+		return frames;
+	}
+
+	// runs a pipeline from warmup frames before begin to end and keeps the output from begin on.
+	// every segment has its own reader, so the threads share nothing but the output vector of their segment.
+	void OfflineProcessor::process_segment(const std::string& input_file, long long begin, long long end, std::vector<short>* output){
+		WavReader reader(input_file);
+		int buf_size = m_frame_size * reader.get_channels() * (reader.get_bit_per_sample() / 8);
+		long long start = std::max(0LL, begin - m_warmup);
+		reader.seek(start * buf_size);
+		Pipeline pipeline(m_config);
+		std::vector<char> buf(buf_size);
+		std::vector<float> input(MAX_MICROPHONES * m_frame_size, 0.f);
+		std::vector<float> frame_output(m_frame_size, 0.f);
+		output->reserve((size_t)(end - begin) * m_frame_size);
+		for (long long frame = start; frame < end; ++frame){
+			int buf_filled = 0;
+			reader.read(&buf[0], buf_size, &buf_filled);
+			if (buf_filled < buf_size){
+				break;
+			}
+			reader.convert_format(&input[0], &buf[0], buf_size);
+			pipeline.process(&input[0], &frame_output[0]);
+			if (frame < begin){
+				continue;
+			}
+			for (int i = 0; i < m_frame_size; ++i){
+				output->push_back((short)(frame_output[i] * SHRT_MAX));
+			}
+		}
+	}
+}
@@ -0,0 +1,39 @@
+#ifndef OFFLINEPROCESSOR_H_
+#define OFFLINEPROCESSOR_H_
+
+#include <string>
+#include <vector>
+#include "Pipeline.h"
+
+namespace Beam{
+// default warm-up in front of every segment. the slowest state is the noise floor of the localization,
+// which rises with a time constant of 20 s. the noise models of the VAD and the noise suppressors
+// and the localization history settle within a few seconds.
+#define OFFLINE_WARMUP_SECONDS 20.0
+
+	/// beamforms a recording on several threads. the file is cut into segments of consecutive frames,
+	/// every segment runs on its own thread with its own pipeline, and the outputs are stitched back together.
+	/// each pipeline starts warmup frames before its segment and drops their output, so the adaptive state
+	/// (noise models, localization history, gains) has converged when the segment starts.
+	/// the output is close to the one of a single pipeline, not identical: a decision that comes out differently
+	/// in the warm-up (e.g. voice or beam) still shows later. the first segment is identical.
+	class OfflineProcessor{
+	public:
+		/// segments <= 0 uses one segment per hardware thread. warmup < 0 uses OFFLINE_WARMUP_SECONDS.
+		OfflineProcessor(const PipelineConfig& config = PipelineConfig(), int segments = 0, int warmup = -1);
+		int segments() const { return m_segments; }
+		/// warm-up frames in front of every segment but the first.
+		int warmup() const { return m_warmup; }
+		/// beamform a wav file into a mono 16 bit wav file at SAMPLE_RATE. a partial frame at the end is dropped.
+		/// returns the number of frames written.
+		long long process_file(const std::string& input_file, const std::string& output_file);
+	private:
+		void process_segment(const std::string& input_file, long long begin, long long end, std::vector<short>* output);
+		PipelineConfig m_config;
+		int m_frame_size;
+		int m_segments;
+		int m_warmup;
+	};
+}
+
+#endif /* OFFLINEPROCESSOR_H_ */
@@ -0,0 +1,109 @@
+#include "PerfCounters.h"
+#include <cstring>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace Beam{
+#ifdef __linux__
+	static int open_counter(PerfCounter counter, int group){
+		perf_event_attr attr;
+		memset(&attr, 0, sizeof(attr));
+		attr.size = sizeof(attr);
+		attr.type = PERF_TYPE_HARDWARE;
+		switch (counter){
+		case PERF_CYCLES:
+			attr.config = PERF_COUNT_HW_CPU_CYCLES;
+			break;
+		case PERF_INSTRUCTIONS:
+			attr.config = PERF_COUNT_HW_INSTRUCTIONS;
+			break;
+		case PERF_L1D_MISSES:
+			attr.type = PERF_TYPE_HW_CACHE;
+			attr.config = PERF_COUNT_HW_CACHE_L1D | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+			break;
+		case PERF_LLC_MISSES:
+			attr.config = PERF_COUNT_HW_CACHE_MISSES;
+			break;
+		default:
+			attr.config = PERF_COUNT_HW_BRANCH_MISSES;
+			break;
+		}
+		// the leader starts disabled and enables the whole group once it is complete.
+		attr.disabled = group < 0 ? 1 : 0;
+		attr.exclude_kernel = 1;
+		attr.exclude_hv = 1;
+		attr.read_format = PERF_FORMAT_GROUP;
+		return (int)syscall(__NR_perf_event_open, &attr, 0, -1, group, 0);
+	}
+#endif
+
+	PerfCounters::PerfCounters() : m_leader(-1), m_opened(0){
+		for (int counter = 0; counter < PERF_COUNTERS; ++counter){
+			m_fds[counter] = -1;
+			m_index[counter] = -1;
+		}
+#ifdef __linux__
+		for (int counter = 0; counter < PERF_COUNTERS; ++counter){
+			int fd = open_counter((PerfCounter)counter, m_leader);
+			if (fd < 0){
+				continue;
+			}
+			if (m_leader < 0){
+				m_leader = fd;
+			}
+			m_fds[counter] = fd;
+			m_index[counter] = m_opened++;
+		}
+		if (m_leader >= 0){
+			ioctl(m_leader, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+			ioctl(m_leader, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+		}
+#endif
+	}
+
+	PerfCounters::~PerfCounters(){
+#ifdef __linux__
+		for (int counter = 0; counter < PERF_COUNTERS; ++counter){
+			if (m_fds[counter] >= 0){
+				close(m_fds[counter]);
+			}
+		}
+#endif
+	}
+
+	void PerfCounters::read(long long* values) const{
+		// the group is read as the number of counters followed by their values, in the order they were opened.
+		unsigned long long group[PERF_COUNTERS + 1] = { 0 };
+#ifdef __linux__
+		if (m_leader >= 0 && ::read(m_leader, group, sizeof(group)) < (ssize_t)sizeof(unsigned long long)){
+			group[0] = 0;
+		}
+#endif
+		for (int counter = 0; counter < PERF_COUNTERS; ++counter){
+			int index = m_index[counter];
+			values[counter] = index >= 0 && (unsigned long long)index < group[0] ? (long long)group[index + 1] : 0;
+		}
+	}
+
+	const char* PerfCounters::name(PerfCounter counter){
+		switch (counter){
+		case PERF_CYCLES:
+			return "cycles";
+		case PERF_INSTRUCTIONS:
+			return "instructions";
+		case PERF_L1D_MISSES:
+			return "L1D misses";
+		case PERF_LLC_MISSES:
+			return "LLC misses";
+		case PERF_BRANCH_MISSES:
+			return "branch misses";
+		default:
+			return "unknown";
+		}
+	}
+}
@@ -0,0 +1,41 @@
+#ifndef PERFCOUNTERS_H_
+#define PERFCOUNTERS_H_
+
+namespace Beam{
+	/// hardware events counted by PerfCounters.
+	enum PerfCounter{
+		PERF_CYCLES = 0,
+		PERF_INSTRUCTIONS,
+		PERF_L1D_MISSES, // L1 data cache read misses.
+		PERF_LLC_MISSES, // last level cache misses.
+		PERF_BRANCH_MISSES,
+		PERF_COUNTERS
+	};
+
+	/// cpu event counters of the calling thread from perf_event_open, user space only.
+	/// all counters are one group, so they are scheduled onto the pmu together and read with one system call.
+	/// counters the kernel refuses (no pmu in a vm, perf_event_paranoid, other systems than linux) read 0,
+	/// see available().
+	class PerfCounters{
+	public:
+		/// open and start the counters of the calling thread.
+		PerfCounters();
+		~PerfCounters();
+		/// true if the counter could be opened.
+		bool available(PerfCounter counter) const { return m_index[counter] >= 0; }
+		/// true if any counter could be opened.
+		bool available() const { return m_leader >= 0; }
+		/// the current counts, PERF_COUNTERS values.
+		void read(long long* values) const;
+		static const char* name(PerfCounter counter);
+	private:
+		PerfCounters(const PerfCounters&);
+		PerfCounters& operator=(const PerfCounters&);
+		int m_fds[PERF_COUNTERS];
+		int m_index[PERF_COUNTERS]; // position of the counter in the group, -1 if it is not open.
+		int m_leader; // file descriptor of the group leader, -1 if no counter is open.
+		int m_opened; // number of open counters.
+	};
+}
+
+#endif /* PERFCOUNTERS_H_ */
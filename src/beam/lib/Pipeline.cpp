@@ -1,45 +1,131 @@
 #include "Pipeline.h"
 
 namespace Beam{
-	Pipeline* Pipeline::p_instance = NULL;
-
-	Pipeline::Pipeline() : m_noise_floor(20.0, 0.04, 30000.0, 0.0){
-		// initialize band pass filter.
-		DSPFilter::band_pass_mclt(m_band_pass_filter, 500.f / SAMPLE_RATE, 1000.f / SAMPLE_RATE, 2000.f / SAMPLE_RATE, 3500.f / SAMPLE_RATE);
-		// initialize noise suppressors.
+	PipelineFrame::PipelineFrame(int frame_size, int num_beams) : phase(0), angle(0.f), confidence(0.f), time(0.0), voice_found(false){
 		for (int channel = 0; channel < MAX_MICROPHONES; ++channel){
-			m_ssl_noise_suppressor[channel].init(SAMPLE_RATE, FRAME_SIZE, 1.f, 10.f);
-			m_pre_noise_suppressor[channel].init(SAMPLE_RATE, FRAME_SIZE, 1.f, 1.f);
-			m_pre_suppressor[channel].init(SAMPLE_RATE, FRAME_SIZE, 1.f, 10.f);
+			spectra[channel].assign(frame_size, std::complex<float>(0.f, 0.f));
 		}
-		m_out_noise_suppressor.init(SAMPLE_RATE, FRAME_SIZE, 1.f, 10.f);
-		m_ssl.init(SAMPLE_RATE, FRAME_SIZE);
-		// initialize persistent and dynamic gains
+		spectrum.assign(frame_size, std::complex<float>(0.f, 0.f));
+		for (int index = 0; index < num_beams; ++index){
+			beam_spectra[index].assign(frame_size, std::complex<float>(0.f, 0.f));
+		}
+	}
+
+	static int pipeline_frame_size(const PipelineConfig& config){
+		return Pipeline::supported_frame_size(config.frame_size) ? config.frame_size : FRAME_SIZE;
+	}
+
+	static int pipeline_num_beams(const PipelineConfig& config){
+		int num_beams = 0;
+		for (int beam = 0; beam < MAX_BEAMS; ++beam){
+			if (config.beams & (1u << beam)){
+				++num_beams;
+			}
+		}
+		return num_beams;
+	}
+
+	Pipeline::Pipeline(const PipelineConfig& config) : m_config(config), m_frame_size(pipeline_frame_size(config)),
+		m_num_beams(pipeline_num_beams(config)), m_frame(m_frame_size, m_num_beams), m_plan(2 * m_frame_size, MAX_MICROPHONES), m_synthesis_plan(2 * m_frame_size){
+		const int frame_size = m_frame_size;
+		m_config.frame_size = frame_size;
+		m_config.calibration = config.calibration && config.localization;
+		// initialize noise suppressors and dereverberation.
 		for (int channel = 0; channel < MAX_MICROPHONES; ++channel){
-			m_dynamic_gains[channel].assign(FRAME_SIZE, std::complex<float>(1.f, 0.f));
+			m_pre_noise_suppressor[channel].init(SAMPLE_RATE, frame_size, 1.f, 1.f);
 		}
+		if (m_config.pre_noise_suppression){
+			m_pre_suppressor.reset(new NoiseSuppressor[MAX_MICROPHONES]);
+			for (int channel = 0; channel < MAX_MICROPHONES; ++channel){
+				m_pre_suppressor[channel].init(SAMPLE_RATE, frame_size, 1.f, 10.f);
+			}
+		}
+		if (m_config.dereverberation){
+			m_dereverb.reset(new DeReverb[MAX_MICROPHONES]);
+			for (int channel = 0; channel < MAX_MICROPHONES; ++channel){
+				m_dereverb[channel].init(frame_size);
+			}
+		}
+		// initialize the localization.
+		if (m_config.localization){
+			// initialize band pass filter.
+			DSPFilter::band_pass_mclt(m_band_pass_filter, 500.f / SAMPLE_RATE, 1000.f / SAMPLE_RATE, 2000.f / SAMPLE_RATE, 3500.f / SAMPLE_RATE, frame_size);
+			m_ssl_noise_suppressor.reset(new NoiseSuppressor[MAX_MICROPHONES]);
+			for (int channel = 0; channel < MAX_MICROPHONES; ++channel){
+				m_ssl_noise_suppressor[channel].init(SAMPLE_RATE, frame_size, 1.f, 10.f);
+				m_input_channels[channel].assign(frame_size, std::complex<float>(0.f, 0.f));
+			}
+			m_noise_floor.reset(new Tracker(20.0, 0.04, 30000.0, 0.0));
+			m_ssl.reset(new SoundSourceLocalizer());
+			m_ssl->init(SAMPLE_RATE, frame_size);
+		}
+		// initialize persistent and dynamic gains
 		for (int channel = 0; channel < MAX_MICROPHONES; ++channel){
 			for (int sub = 0; sub < MAX_GAIN_SUBBANDS; ++sub){
 				m_persistent_gains[channel][sub] = std::complex<float>(1.f, 0.f);
 			}
 		}
-		// initialize m_input_channels
-		for (int channel = 0; channel < MAX_MICROPHONES; ++channel){
-			m_input_channels[channel].assign(FRAME_SIZE, std::complex<float>(0.f, 0.f));
+		if (m_config.calibration){
+			m_calibrator.reset(new Calibrator(frame_size));
+			for (int channel = 0; channel < MAX_MICROPHONES; ++channel){
+				m_dynamic_gains[channel].assign(frame_size, std::complex<float>(1.f, 0.f));
+			}
+			expand_gain();
 		}
-		// initialize input buffers
-		for (int channel = 0; channel < MAX_MICROPHONES; ++channel){
-			std::fill(m_input_prev[channel], m_input_prev[channel] + FRAME_SIZE, 0.f);
-			std::fill(m_input[channel], m_input[channel] + 2 * FRAME_SIZE, 0.f);
+		// initialize the beamformer.
+		switch (m_config.beamformer){
+		case BEAMFORMER_DELAY_SUM:
+			m_delay_sum.reset(new DelaySumBeamformer(frame_size));
+			break;
+		case BEAMFORMER_GSC:
+			m_gsc.reset(new GSCBeamformer(frame_size));
+			m_gsc_plan.reset(new FFTPlan(2 * frame_size));
+			m_gsc_output.assign(2 * frame_size, 0.f);
+			m_frame.samples.assign(MAX_MICROPHONES * frame_size, 0.f);
+			break;
+		case BEAMFORMER_ADAPTIVE:
+			m_beamformer.reset(new Beamformer(frame_size));
+			m_beamformer->set_adaptive(true);
+			break;
+		default:
+			m_config.beamformer = BEAMFORMER_FIXED;
+			m_beamformer.reset(new Beamformer(frame_size));
+			break;
 		}
-		std::fill(m_output_prev, m_output_prev + FRAME_SIZE, 0.f);
-		std::fill(m_output, m_output + 2 * FRAME_SIZE, 0.f);
-		for (int channel = 0; channel < MAX_MICROPHONES; ++channel){
-			m_frequency_input[channel].assign(FRAME_SIZE, std::complex<float>(0.f, 0.f));
+		// the beams of the config, which need the fixed beams also next to the other beamformers.
+		m_config.beams = config.beams & ALL_BEAMS;
+		int index = 0;
+		for (int beam = 0; beam < MAX_BEAMS; ++beam){
+			if (m_config.beams & (1u << beam)){
+				m_beams[index++] = beam;
+			}
+		}
+		if (m_num_beams > 0){
+			if (!m_beamformer){
+				m_beamformer.reset(new Beamformer(frame_size));
+			}
+			m_beam_output_prev.assign((size_t)m_num_beams * frame_size, 0.f);
+		}
+		// initialize the noise suppressor of the output.
+		switch (m_config.noise_suppressor){
+		case NOISE_SUPPRESSOR_MSR:
+			m_vad.reset(new MsrVAD(frame_size));
+			m_ns.reset(new MsrNS(frame_size));
+			break;
+		case NOISE_SUPPRESSOR_SPECTRAL:
+			m_out_noise_suppressor.reset(new NoiseSuppressor());
+			m_out_noise_suppressor->init(SAMPLE_RATE, frame_size, 1.f, 10.f);
+			break;
+		default:
+			m_config.noise_suppressor = NOISE_SUPPRESSOR_NONE;
+			break;
 		}
-		m_frequency_output.assign(FRAME_SIZE, std::complex<float>(0.f, 0.f));
-		// initialize gains.
-		expand_gain();
+		if (m_config.profile){
+			m_profiler.reset(new StageProfiler(m_config.perf_counters));
+		}
+		// initialize input buffers
+		m_input.assign(2 * frame_size * MAX_MICROPHONES, 0.f);
+		m_output_prev.assign(frame_size, 0.f);
 		m_refresh_gain = 0;
 		m_confidence = 0.f;
 		// initialize m_time.
@@ -53,153 +139,179 @@ namespace Beam{
 		// initialize m_frame_number.
 		m_frame_number = 0;
 		m_voice_engery = 0.f;
-		std::fill(m_gsc_output_prev, m_gsc_output_prev + FRAME_SIZE, 0.f);
-		std::fill(m_ref_prev, m_ref_prev + FRAME_SIZE, 0.f);
-		for (int channel = 0; channel < MAX_MICROPHONES; ++channel){
-			std::fill(m_gsc_input_prev[channel], m_gsc_input_prev[channel] + FRAME_SIZE, 0.f);
-		}
 		m_gain = 1.f;
 	}
 
-	Pipeline* Pipeline::instance(){
-		if (p_instance == NULL){
-			p_instance = new Pipeline;
+	std::unique_ptr<Pipeline> Pipeline::create(const PipelineConfig& config){
+		return std::unique_ptr<Pipeline>(new Pipeline(config));
+	}
+
+	bool Pipeline::supported_frame_size(int frame_size){
+		if (frame_size < MIN_FRAME_SIZE || frame_size > MAX_FRAME_SIZE){
+			return false;
+		}
+		// the transforms have 2 * frame_size points, which the fft supports as 2^n, 5 * 2^n and 15 * 2^n.
+		// at SAMPLE_RATE 10 ms and 20 ms are 160 and 320 samples (base 5), 15 ms and 30 ms are 240 and 480 (base 15).
+		int power_of_2 = frame_size;
+		if (power_of_2 % 15 == 0){
+			power_of_2 /= 15;
 		}
-		return p_instance;
+		else if (power_of_2 % 5 == 0){
+			power_of_2 /= 5;
+		}
+		return (power_of_2 & (power_of_2 - 1)) == 0;
+	}
+
+	void Pipeline::process(float* input, float* output){
+		process(input, output, NULL);
 	}
 
-	void Pipeline::phase_compensation(float* fft_ptr, bool analysis){
-		int fftSize = FRAME_SIZE * 2;
-		float* realPtr = fft_ptr + 1;
-		float* imagPtr = fft_ptr + fftSize - 1;
+	void Pipeline::process(float* input, float* output, float* const* beam_outputs){
+		analyze(input, m_gain, m_frame);
+		localize(m_frame);
+		beamform(m_frame);
+		synthesize(m_frame, output, beam_outputs);
+	}
 
-		if ((((m_frame_number & 0x03) == 1) && analysis) ||
-			(((m_frame_number & 0x03) == 3) && !analysis))
-		{
-			// first sample X[1]
-			float fltTemp = *realPtr;
-			*realPtr = -*imagPtr;
-			*imagPtr = fltTemp;
-			realPtr++;
-			imagPtr--;
-			for (int i = 2; i < fftSize / 2; i = i + 2)
-			{
-				// index i is corresponding to X[i].
-				fltTemp = *realPtr;
-				*realPtr = *imagPtr;
-				*imagPtr = -fltTemp;
-				realPtr++;
-				imagPtr--;
-				fltTemp = *realPtr;
-				*realPtr = -*imagPtr;
-				*imagPtr = fltTemp;
-				realPtr++;
-				imagPtr--;
+	void Pipeline::analyze(float* input, float gain, PipelineFrame& frame){
+		const int frame_size = m_frame_size;
+		ProfileMark start = profile_start();
+		// shift the previous frame to the first half and interleave the new one into the second half.
+		std::copy(m_input.begin() + frame_size * MAX_MICROPHONES, m_input.end(), m_input.begin());
+		for (int channel = 0; channel < AVALABLE_MICROPHONES; ++channel){
+			float* samples = input + channel * frame_size;
+			float* samples_out = &m_input[frame_size * MAX_MICROPHONES + channel];
+			for (int i = 0; i < frame_size; ++i){
+				samples[i] *= gain;
+				samples_out[i * MAX_MICROPHONES] = samples[i];
 			}
 		}
-		else if ((((m_frame_number & 0x03) == 1) && !analysis) ||
-			(((m_frame_number & 0x03) == 3) && analysis))
-		{
-			// First sample, X[1]
-			float fltTemp = *realPtr;
-			*realPtr = *imagPtr;
-			*imagPtr = -fltTemp;
-			realPtr++;
-			imagPtr--;
-			for (int i = 2; i < fftSize / 2; i = i + 2)
-			{
-				// index i is corresponding to X[i].
-				fltTemp = *realPtr;
-				*realPtr = -*imagPtr;
-				*imagPtr = fltTemp;
-				realPtr++;
-				imagPtr--;
-				fltTemp = *realPtr;
-				*realPtr = *imagPtr;
-				*imagPtr = -fltTemp;
-				realPtr++;
-				imagPtr--;
-			}
+		if (m_gsc){
+			frame.samples.assign(input, input + MAX_MICROPHONES * frame_size);
 		}
-		else if ((m_frame_number & 0x03) == 2)
-		{  // phase compensation term is -1
-			for (int i = 1; i < fftSize / 2; i++)
-			{
-				*realPtr = -*realPtr;
-				*imagPtr = -*imagPtr;
-				realPtr++;
-				imagPtr--;
-			}
-			// CTODO: can not do phase compensation for coefficient fftSize/2 - 1
+		// the MCLT writes the interleaved complex spectra straight into the frame.
+		// the frame phase compensation is part of its modulation, the inverse MCLT takes it out again.
+		frame.phase = m_frame_number & 0x03;
+		float* spectra[MAX_MICROPHONES];
+		for (int channel = 0; channel < MAX_MICROPHONES; ++channel){
+			spectra[channel] = reinterpret_cast<float*>(&frame.spectra[channel][0]);
+		}
+		ProfileMark kernel = profile_start();
+		MCLT::AecCcsFwdMcltBatch(m_plan, &m_input[0], spectra, frame.phase);
+		profile(PROFILE_MCLT, kernel);
+		++m_frame_number;
+		profile(PROFILE_ANALYSIS, start);
+	}
+
+	void Pipeline::localize(PipelineFrame& frame){
+		ProfileMark start = profile_start();
+		preprocess(frame.spectra); // noise suppression and dynamic gain
+		start = profile(PROFILE_PREPROCESS, start);
+		if (m_ssl){
+			source_localize(frame.spectra, &frame.angle); // sound source localization
+			smart_calibration(frame.spectra);
+		}
+		else{
+			m_time += (double)m_frame_size / (double)SAMPLE_RATE;
+			frame.angle = m_angle;
 		}
+		profile(PROFILE_LOCALIZATION, start);
+		frame.confidence = m_confidence;
+		frame.time = m_time;
+		frame.voice_found = m_voice_found;
 	}
 
-	void Pipeline::convert_input(std::vector<std::complex<float> >& input, float* fft_ptr){
-		input[0].real(fft_ptr[0]);
-		input[0].imag(0.f);
-		for (int i = 1; i < FRAME_SIZE; ++i){
-			input[i].real(fft_ptr[i]);
-			input[i].imag(fft_ptr[TWO_FRAME_SIZE - i]);
+	void Pipeline::beamform(PipelineFrame& frame){
+		ProfileMark start = profile_start();
+		dereverbration(frame.spectra);
+		if (m_gsc){
+			gsc(frame);
+		}
+		else if (m_config.beamformer != BEAMFORMER_FIXED || m_num_beams == 0){
+			steer(frame.spectra, frame.spectrum, frame.angle, frame.confidence, frame.time);
+		}
+		if (m_num_beams > 0){
+			fixed_beams(frame);
 		}
+		profile(PROFILE_BEAMFORMING, start);
 	}
 
-	void Pipeline::convert_output(const std::vector<std::complex<float> >& output, float* fft_ptr){
-		fft_ptr[0] = output[0].real();
-		fft_ptr[FRAME_SIZE] = 0.f;
-		for (int i = 1; i < FRAME_SIZE; ++i){
-			fft_ptr[i] = output[i].real();
-			fft_ptr[TWO_FRAME_SIZE - i] = output[i].imag();
+	void Pipeline::fixed_beams(PipelineFrame& frame){
+		int rows = m_num_beams;
+		for (int index = 0; index < m_num_beams; ++index){
+			m_beam_spectra[index] = &frame.beam_spectra[index][0];
 		}
+		if (m_config.beamformer == BEAMFORMER_FIXED){
+			m_beams[rows] = m_beamformer->select_beam(frame.angle, frame.confidence);
+			m_beam_spectra[rows++] = &frame.spectrum[0];
+		}
+		ProfileMark start = profile_start();
+		m_beamformer->compute_beams(frame.spectra, m_beam_spectra, m_beams, rows);
+		profile(PROFILE_FIXED_BEAMS, start);
 	}
 
-	void Pipeline::process(float input[MAX_MICROPHONES][FRAME_SIZE], float output[FRAME_SIZE]){
-		for (int channel = 0; channel < AVALABLE_MICROPHONES; ++channel){
-			for (int i = 0; i < FRAME_SIZE; ++i){
-				input[channel][i] *= m_gain;
-			}
-			for (int i = 0; i < FRAME_SIZE; ++i) {
-				m_input[channel][i] = m_input_prev[channel][i];
-			}
-			for (int i = FRAME_SIZE; i < TWO_FRAME_SIZE; ++i) {
-				m_input[channel][i] = input[channel][i - FRAME_SIZE];
+	void Pipeline::steer(std::vector<std::complex<float> >* input, std::vector<std::complex<float> >& output, float angle, float confidence, double time){
+		if (m_delay_sum){
+			m_delay_sum->compute(input, output, angle, confidence, time);
+		}
+		else{
+			ProfileMark start = profile_start();
+			m_beamformer->compute(input, output, angle, confidence, time);
+			profile(PROFILE_FIXED_BEAMS, start);
+		}
+	}
+
+	void Pipeline::gsc(PipelineFrame& frame){
+		// the GSC works on the time domain input. its output is transformed like the channels,
+		// the MCLT of the previous and the current frame with the phase of the frame.
+		const int frame_size = m_frame_size;
+		std::copy(m_gsc_output.begin() + frame_size, m_gsc_output.end(), m_gsc_output.begin());
+		m_gsc->compute(&m_gsc_output[frame_size], &frame.samples[0], frame.angle, frame.voice_found);
+		MCLT::AecCcsFwdMclt(*m_gsc_plan, &m_gsc_output[0], reinterpret_cast<float*>(&frame.spectrum[0]), frame.phase);
+	}
+
+	void Pipeline::synthesize(PipelineFrame& frame, float* output, float* const* beam_outputs){
+		std::complex<float>* output_spectrum = &frame.spectrum[0];
+		ProfileMark start = profile_start();
+		if (m_ns){
+			suppress_noise(output_spectrum);
+		}
+		else if (m_out_noise_suppressor){
+			postprocessing(frame.spectrum);
+		}
+		start = profile(PROFILE_NOISE_SUPPRESSION, start);
+		MCLT::AecCcsInvMcltOverlapAdd(m_synthesis_plan, reinterpret_cast<float*>(output_spectrum), &m_output_prev[0], output, frame.phase);
+		// the beams share the tables and the scratch of the plan, only their overlap is their own.
+		if (beam_outputs){
+			for (int index = 0; index < m_num_beams; ++index){
+				MCLT::AecCcsInvMcltOverlapAdd(m_synthesis_plan, reinterpret_cast<float*>(&frame.beam_spectra[index][0]),
+					&m_beam_output_prev[(size_t)index * m_frame_size], beam_outputs[index], frame.phase);
 			}
-			std::copy(input[channel], input[channel] + FRAME_SIZE, m_input_prev[channel]);
-			float input_fft[TWO_FRAME_SIZE];
-			MCLT::AecCcsFwdMclt(m_input[channel], input_fft, true);
-			phase_compensation(input_fft, true);
-			convert_input(m_frequency_input[channel], input_fft);
-		}
-		float angle = 0.f;
-		preprocess(m_frequency_input); // noise suppression and dynamic gain
-		source_localize(m_frequency_input, &angle); // sound source localization
-		//smart_calibration(m_frequency_input);
-		beamforming(m_frequency_input, m_frequency_output);
-		float output_fft[2 * FRAME_SIZE];
-		convert_output(m_frequency_output, output_fft);
-		suppress_noise(output_fft);
-		phase_compensation(output_fft, false);
-		Beam::MCLT::AecCcsInvMclt(output_fft, m_output, true);
-		for (int i = 0; i < FRAME_SIZE; ++i){
-			output[i] = m_output[i] + m_output_prev[i];
-		}
-		gain_control(m_voice_found, output);
-		std::copy(m_output + FRAME_SIZE, m_output + TWO_FRAME_SIZE, m_output_prev);
-		++m_frame_number;
+		}
+		start = profile(PROFILE_SYNTHESIS, start);
+		gain_control(frame.voice_found, output);
+		profile(PROFILE_GAIN_CONTROL, start);
 	}
 
 	void Pipeline::preprocess(std::vector<std::complex<float> >* input){
 		for (int channel = 0; channel < AVALABLE_MICROPHONES; ++channel){
-			// TODO check dynamic gains here.
-			//m_pre_suppressor[channel].noise_compensation(input[channel]); // NS here.
-			//for (int bin = 0; bin < FRAME_SIZE; ++bin){
-			//	input[channel][bin] *= m_dynamic_gains[channel][bin];
-			//}
+			if (m_pre_suppressor){
+				m_pre_suppressor[channel].noise_compensation(input[channel]); // NS here.
+			}
+			if (m_calibrator){
+				for (int bin = 0; bin < m_frame_size; ++bin){
+					input[channel][bin] *= m_dynamic_gains[channel][bin];
+				}
+			}
 			m_pre_noise_suppressor[channel].phase_compensation(input[channel]);
 		}
 	}
 
-	void Pipeline::suppress_noise(float* fft_ptr){
-		int iSNR = (int)m_vad.GetSNR();
+	void Pipeline::suppress_noise(std::complex<float>* spectrum){
+		if (!m_ns){
+			return;
+		}
+		int iSNR = (int)m_vad->GetSNR();
 		bool enableNS = true;
 		if (iSNR > 130) {
 			enableNS = false;
@@ -207,12 +319,18 @@ namespace Beam{
 		else if (iSNR < 25) {
 			enableNS = true;
 		}
-		m_vad.process(fft_ptr);
-		m_ns.process(fft_ptr, &m_vad, enableNS);
+		ProfileMark start = profile_start();
+		m_vad->process(spectrum);
+		profile(PROFILE_VAD, start);
+		m_ns->process(spectrum, m_vad.get(), enableNS);
 	}
 
 	void Pipeline::source_localize(std::vector<std::complex<float> >* input, float* p_angle){
-		m_time += (double)FRAME_SIZE / (double)SAMPLE_RATE;
+		if (!m_ssl){
+			*p_angle = m_angle;
+			return;
+		}
+		m_time += (double)m_frame_size / (double)SAMPLE_RATE;
 		m_source_found = false;
 		//  Apply the SSL band pass filter to the input channels
 		//  and have a separate copy of the input channels 
@@ -231,7 +349,7 @@ namespace Beam{
 			energy += (double)Utils::computeRMS(m_input_channels[channel]);
 		}
 		energy /= AVALABLE_MICROPHONES;
-		double floor = m_noise_floor.nextLevel(m_time, energy);
+		double floor = m_noise_floor->nextLevel(m_time, energy);
 		//if (energy > SSL_RELATIVE_ENERGY_THRESHOLD * floor && energy > SSL_ABSOLUTE_ENERGY_THRESHOLD){
 		if (energy > SSL_RELATIVE_ENERGY_THRESHOLD * floor){
 			if (m_voice_engery == 0.f){
@@ -244,9 +362,11 @@ namespace Beam{
 			m_voice_found = true;
 			float angle;
 			float weight;
-			m_ssl.process(m_input_channels, input, &angle, &weight);
+			ProfileMark start = profile_start();
+			m_ssl->process(m_input_channels, input, &angle, &weight);
+			profile(PROFILE_SSL, start);
 			if (weight > SSL_CONTRAST_THRESHOLD){
-				m_ssl.process_next_sample(m_time, angle, weight);
+				m_ssl->process_next_sample(m_time, angle, weight);
 				m_source_found = true;
 			}
 		}
@@ -256,19 +376,22 @@ namespace Beam{
 		float std_dev;
 		int valid;
 		int num;
-		m_ssl.get_average(m_time, p_angle, &m_confidence, &std_dev, &num, &valid);
+		m_ssl->get_average(m_time, p_angle, &m_confidence, &std_dev, &num, &valid);
 		m_angle = *p_angle;
 	}
 
 	void Pipeline::dereverbration(std::vector<std::complex<float> >* input){
+		if (!m_dereverb){
+			return;
+		}
 		for (int channel = 0; channel < MAX_MICROPHONES; ++channel){
 			m_dereverb[channel].suppress(input[channel]);
 		}
 	}
 
 	void Pipeline::smart_calibration(std::vector<std::complex<float> >* input){
-		if (m_source_found){
-			float sigma = m_calibrator.calibrate(m_angle, m_input_channels, m_persistent_gains);
+		if (m_calibrator && m_source_found){
+			m_calibrator->calibrate(m_angle, m_input_channels, m_persistent_gains);
 			++m_refresh_gain;
 			if (m_refresh_gain > 200){
 				expand_gain();
@@ -278,23 +401,25 @@ namespace Beam{
 	}
 
 	void Pipeline::beamforming(std::vector<std::complex<float> >* input, std::vector<std::complex<float> >& output){
-		m_beamformer.compute(input, output, m_angle, m_confidence, m_time);
+		steer(input, output, m_angle, m_confidence, m_time);
 	}
 
 	void Pipeline::postprocessing(std::vector<std::complex<float> >& input){
-		//m_out_noise_suppressor.frequency_shifting(input);
-		m_out_noise_suppressor.noise_compensation(input);
+		if (m_out_noise_suppressor){
+			//m_out_noise_suppressor->frequency_shifting(input);
+			m_out_noise_suppressor->noise_compensation(input);
+		}
 	}
 
 	void Pipeline::expand_gain(){
 		std::complex<float> zero(0.f, 0.f);
 		// use MCLT
-		float freq_step = (float)SAMPLE_RATE / FRAME_SIZE / 2.f;
+		float freq_step = (float)SAMPLE_RATE / m_frame_size / 2.f;
 		float freq_beg = 0.f;
 		if (USE_MCLT){
 			freq_beg = freq_step / 2.f;
 		}
-		for (int index = 0; index < FRAME_SIZE; ++index){
+		for (int index = 0; index < m_frame_size; ++index){
 			int interp_high = 1;
 			int interp_low = 0;
 			float freq = freq_beg + index * freq_step;
@@ -329,9 +454,9 @@ namespace Beam{
 		}
 	}
 
-	void Pipeline::gain_control(bool voice, float input[FRAME_SIZE]) {
+	void Pipeline::gain_control(bool voice, float* input) {
 		if (voice){
-			float max = *std::max_element(input, input + FRAME_SIZE);
+			float max = *std::max_element(input, input + m_frame_size);
 			if (max > 0.6f){
 				m_gain *= 0.95f;
 			}
@@ -2,6 +2,7 @@
 #define PIPELINE_H_
 
 #include <iostream>
+#include <memory>
 #include "Beamformer.h"
 #include "Calibrator.h"
 #include "DelaySumBeamformer.h"
@@ -14,23 +15,123 @@
 #include "MsrNS.h"
 #include "NoiseSuppressor.h"
 #include "SoundSourceLocalizer.h"
+#include "StageProfiler.h"
 #include "Tracker.h"
 #include "WavReader.h"
 #include "WavWriter.h"
 
 namespace Beam{
+// PipelineConfig::beams with all the fixed beams of KinectConfig::kinect_beams.
+#define ALL_BEAMS ((1u << MAX_BEAMS) - 1)
+
+	/// beamformers a pipeline can run.
+	enum BeamformerType{
+		BEAMFORMER_FIXED = 0, // fixed beams, the one closest to the sound source is used. see Beamformer.
+		BEAMFORMER_DELAY_SUM, // delay and sum towards the sound source.
+		BEAMFORMER_GSC, // adaptive generalized sidelobe canceller, in the time domain.
+		BEAMFORMER_ADAPTIVE // fixed beams whose weights adapt to the noise bin by bin, see Beamformer::set_adaptive.
+	};
+
+	/// noise suppressors of the beamformer output.
+	enum NoiseSuppressorType{
+		NOISE_SUPPRESSOR_MSR = 0, // MsrNS driven by MsrVAD.
+		NOISE_SUPPRESSOR_SPECTRAL, // NoiseSuppressor::noise_compensation.
+		NOISE_SUPPRESSOR_NONE
+	};
+
+	/// settings of one pipeline: the frame size and the stages it runs.
+	/// the components of stages that are not selected are not created, so they cost neither time nor memory.
+	struct PipelineConfig{
+		PipelineConfig() : frame_size(FRAME_SIZE), beamformer(BEAMFORMER_FIXED), noise_suppressor(NOISE_SUPPRESSOR_MSR),
+			localization(true), pre_noise_suppression(false), dereverberation(false), calibration(false), profile(false), perf_counters(false), beams(0){}
+		/// samples per channel and frame, see Pipeline::supported_frame_size.
+		int frame_size;
+		BeamformerType beamformer;
+		NoiseSuppressorType noise_suppressor;
+		/// sound source localization. without it the beamformers look straight ahead and the gain control is off.
+		bool localization;
+		/// noise suppression of every channel before the localization.
+		bool pre_noise_suppression;
+		/// reverberation suppression of every channel before the beamforming.
+		bool dereverberation;
+		/// calibration of the channel gains from the localized sound source. needs the localization.
+		bool calibration;
+		/// time every stage, see Pipeline::profiler.
+		bool profile;
+		/// also count cpu events with PerfCounters in every stage. needs profile.
+		bool perf_counters;
+		/// fixed beams to output next to the beamformer output, bit b for beam b of KinectConfig::kinect_beams.
+		/// they are computed in one pass with the fixed beamformer and synthesized on their own, see Pipeline::process.
+		unsigned int beams;
+	};
+
+	/// one frame on its way through the stages of a pipeline, see Pipeline::analyze.
+	struct PipelineFrame{
+		PipelineFrame(int frame_size = FRAME_SIZE, int num_beams = 0);
+		std::vector<std::complex<float> > spectra[MAX_MICROPHONES]; // MCLT of the channels.
+		std::vector<std::complex<float> > spectrum; // beamformer output.
+		std::vector<std::complex<float> > beam_spectra[MAX_BEAMS]; // the fixed beams of PipelineConfig::beams, in beam order.
+		std::vector<float> samples; // time domain input of BEAMFORMER_GSC, empty for the other beamformers.
+		int phase; // frame number & 3, see MCLT.h.
+		// result of the localization, used by the beamforming and the gain control.
+		float angle;
+		float confidence;
+		double time;
+		bool voice_found;
+	};
+
+	/// beamformer of one stream. all state is owned by the pipeline, so a process can run any number of them,
+	/// one per stream. a pipeline must not be used by two threads at the same time.
 	class Pipeline{
 	public:
-		static Pipeline* instance();
-		void phase_compensation(float* fft_ptr, bool analysis);
-		/// input should have FRAME_SIZE.
-		void convert_input(std::vector<std::complex<float> >& input, float* fft_ptr);
-		/// fft_ptr should have 2 * FRAME_SIZE.
-		void convert_output(const std::vector<std::complex<float> >& output, float* fft_ptr);
+		/// unsupported frame sizes fall back to FRAME_SIZE.
+		explicit Pipeline(const PipelineConfig& config = PipelineConfig());
+		/// pipelines are moved, e.g. into a container of streams, but not copied.
+		Pipeline(Pipeline&& other) = default;
+		Pipeline& operator=(Pipeline&& other) = default;
+		/// create a pipeline on the heap.
+		static std::unique_ptr<Pipeline> create(const PipelineConfig& config = PipelineConfig());
+		/// true for 2^n, 5 * 2^n and 15 * 2^n from MIN_FRAME_SIZE to MAX_FRAME_SIZE,
+		/// e.g. 160 and 320 for 10 ms and 20 ms frames.
+		static bool supported_frame_size(int frame_size);
+		/// number of samples per channel and frame, also the number of frequency bins.
+		int frame_size() const { return m_frame_size; }
+		/// the configuration with the frame size in use. calibration is off without localization.
+		const PipelineConfig& config() const { return m_config; }
 		/// process frame.
-		void process(float input[MAX_MICROPHONES][FRAME_SIZE], float output[FRAME_SIZE]);
-		/// noise suppression.
-		void suppress_noise(float* fft_ptr);
+		/// input holds MAX_MICROPHONES frames of frame_size() samples, channel after channel.
+		/// output receives frame_size() samples.
+		/// the constructor allocates all buffers and state, so process and its stages do not touch the heap.
+		void process(float* input, float* output);
+		/// process with the beams of PipelineConfig::beams: beam_outputs[index] receives frame_size() samples of beam(index).
+		/// they are the fixed beams before the noise suppression, the input gain of the gain control applies to them.
+		void process(float* input, float* output, float* const* beam_outputs);
+		/// number of beams in PipelineConfig::beams.
+		int num_beams() const { return m_num_beams; }
+		/// the beam of KinectConfig::kinect_beams of output index.
+		int beam(int index) const { return m_beams[index]; }
+		/// noise suppression of NOISE_SUPPRESSOR_MSR.
+		void suppress_noise(std::complex<float>* spectrum);
+
+		/// the stages of process(), one after the other. each stage only touches its own part of the pipeline
+		/// and the frame, so different frames can be in different stages on different threads (see StagedPipeline).
+		/// analysis: MCLT of all channels. the input is scaled by gain, which is gain() after the previous frame in process().
+		void analyze(float* input, float gain, PipelineFrame& frame);
+		/// localization: preprocessing, sound source localization and calibration.
+		void localize(PipelineFrame& frame);
+		/// dereverberation and beamforming of frame.spectra into frame.spectrum.
+		void beamform(PipelineFrame& frame);
+		/// post-processing: noise suppression, inverse MCLT and gain control. output receives frame_size() samples,
+		/// beam_outputs, if not NULL, the inverse MCLT of the beams as in process.
+		void synthesize(PipelineFrame& frame, float* output, float* const* beam_outputs = NULL);
+		/// input gain of the gain control, updated by synthesize.
+		float gain() const { return m_gain; }
+		/// the beamformer of BEAMFORMER_FIXED and BEAMFORMER_ADAPTIVE or of the beams, NULL without them.
+		/// e.g. to set the adaptation of BEAMFORMER_ADAPTIVE per bin.
+		Beamformer* beamformer() { return m_beamformer.get(); }
+		/// the stage times if the config has profile set, NULL otherwise.
+		StageProfiler* profiler() { return m_profiler.get(); }
+		const StageProfiler* profiler() const { return m_profiler.get(); }
 
 		// multi-channel inputs.
 		void preprocess(std::vector<std::complex<float> >* input);
@@ -41,52 +142,66 @@ namespace Beam{
 		void beamforming(std::vector<std::complex<float> >* input, std::vector<std::complex<float> >& output);
 		void postprocessing(std::vector<std::complex<float> >& input);
 		void expand_gain();
-		void gain_control(bool voice, float input[FRAME_SIZE]);
+		void gain_control(bool voice, float* input);
 	private:
-		// singleton.
-		Pipeline();
-		Pipeline(Pipeline&);
-		Pipeline& operator=(Pipeline&);
-		static Pipeline* p_instance;
-		// components.
-		std::vector<std::complex<float> > m_band_pass_filter; // band pass filter
+		// fixed beams or delay and sum.
+		void steer(std::vector<std::complex<float> >* input, std::vector<std::complex<float> >& output, float angle, float confidence, double time);
+		// the beams of the config into frame.beam_spectra, with the fixed beamformer output as one more beam of the same pass.
+		void fixed_beams(PipelineFrame& frame);
+		// GSC of frame.samples and MCLT of its output into frame.spectrum.
+		void gsc(PipelineFrame& frame);
+		// start of the next stage, nothing is read without profiling.
+		ProfileMark profile_start() { return m_profiler ? m_profiler->mark() : ProfileMark(); }
+		// record the stage that started at start, returns the start of the next one.
+		ProfileMark profile(ProfileStage stage, const ProfileMark& start) { return m_profiler ? m_profiler->record(stage, start) : start; }
+		PipelineConfig m_config;
+		int m_frame_size;
+		// components. the ones of stages that are not configured are NULL.
 		NoiseSuppressor m_pre_noise_suppressor[MAX_MICROPHONES]; // for phase compensation in the preprocessing.
-		NoiseSuppressor m_ssl_noise_suppressor[MAX_MICROPHONES]; // for noise suppression in ssl.
-		NoiseSuppressor m_pre_suppressor[MAX_MICROPHONES]; // for noise suppression.
-		DeReverb m_dereverb[MAX_MICROPHONES];
-		NoiseSuppressor m_out_noise_suppressor; // for frequency shifting the output.
-		Tracker m_noise_floor; // VAD
-		SoundSourceLocalizer m_ssl; // SSL
-		Calibrator m_calibrator; // Calibrator
-		Beamformer m_beamformer; // MVDR BF
-		//GSCBeamformer m_gsc;
-		//DelaySumBeamformer m_beamformer; // DS BF
+		std::unique_ptr<NoiseSuppressor[]> m_pre_suppressor; // for noise suppression, one per channel.
+		std::unique_ptr<DeReverb[]> m_dereverb; // one per channel.
+		// localization.
+		std::unique_ptr<SoundSourceLocalizer> m_ssl; // SSL
+		std::unique_ptr<NoiseSuppressor[]> m_ssl_noise_suppressor; // for noise suppression in ssl, one per channel.
+		std::unique_ptr<Tracker> m_noise_floor; // VAD
+		std::vector<std::complex<float> > m_band_pass_filter; // band pass filter
+		std::vector<std::complex<float> > m_input_channels[MAX_MICROPHONES];
+		std::unique_ptr<Calibrator> m_calibrator; // Calibrator
+		// beamformers.
+		std::unique_ptr<Beamformer> m_beamformer; // fixed beams
+		std::unique_ptr<DelaySumBeamformer> m_delay_sum; // DS BF
+		std::unique_ptr<GSCBeamformer> m_gsc;
+		std::unique_ptr<FFTPlan> m_gsc_plan; // MCLT of the GSC output.
+		std::vector<float> m_gsc_output; // previous and current frame of the GSC output.
+		// beams of PipelineConfig::beams.
+		int m_num_beams;
+		int m_beams[MAX_BEAMS + 1]; // the beams, then room for the beam of the fixed beamformer.
+		std::complex<float>* m_beam_spectra[MAX_BEAMS + 1]; // their outputs in the frame of fixed_beams.
+		std::vector<float> m_beam_output_prev; // overlap of the inverse MCLT, frame_size per beam.
+		// noise suppressors of the output.
+		std::unique_ptr<MsrNS> m_ns;
+		std::unique_ptr<MsrVAD> m_vad;
+		std::unique_ptr<NoiseSuppressor> m_out_noise_suppressor;
+		std::unique_ptr<StageProfiler> m_profiler;
 		float m_confidence;
 		float m_angle; // sound source angle
 		bool m_voice_found; // result of VAD
 		bool m_source_found;
 		int m_frame_number;
-		// gains.
+		// gains of the calibration.
 		std::vector<std::complex<float> > m_dynamic_gains[MAX_MICROPHONES];
 		std::complex<float> m_persistent_gains[MAX_MICROPHONES][MAX_GAIN_SUBBANDS];
-		std::vector<std::complex<float> > m_input_channels[MAX_MICROPHONES];
 		int m_refresh_gain;
-		float m_input_prev[MAX_MICROPHONES][FRAME_SIZE];
-		float m_input[MAX_MICROPHONES][TWO_FRAME_SIZE];
-		float m_output_prev[FRAME_SIZE];
-		float m_output[2 * FRAME_SIZE];
-		std::vector<std::complex<float> > m_frequency_input[MAX_MICROPHONES];
-		std::vector<std::complex<float> > m_frequency_output;
+		// channel-interleaved: m_input[i * MAX_MICROPHONES + channel]. the first half holds the previous frame.
+		std::vector<float> m_input;
+		std::vector<float> m_output_prev;
+		PipelineFrame m_frame; // the frame of process().
 		// timer. every time preprocess is called, the time is updated.
 		double m_time;
-		MsrNS m_ns;
-		MsrVAD m_vad;
 		float m_voice_engery;
 		float m_gain;
-		float m_gsc_output_prev[FRAME_SIZE];
-		float m_gsc_input_prev[MAX_MICROPHONES][FRAME_SIZE];
-		float m_ref_prev[FRAME_SIZE];
-		FFT m_fft;
+		FFTPlan m_plan; // tables and scratch for the MCLT of all channels.
+		FFTPlan m_synthesis_plan; // the inverse MCLT has its own scratch, so it can run next to the analysis.
 	};
 }
 
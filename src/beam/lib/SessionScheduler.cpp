@@ -0,0 +1,189 @@
+#include "SessionScheduler.h"
+#include <algorithm>
+
+namespace Beam{
+	// the scheduler and the index of the worker running on this thread, so that a worker keeps
+	// the streams it schedules in its own queue.
+	static thread_local const SessionScheduler* t_scheduler = NULL;
+	static thread_local int t_worker = 0;
+
+	SessionScheduler::Stream::Stream(int id, const PipelineConfig& config, FrameCallback callback) : id(id), pipeline(config),
+		callback(callback), scheduled(false){
+		output.assign(pipeline.frame_size(), 0.f);
+	}
+
+	SessionScheduler::SessionScheduler(int threads) : m_queued(0), m_pending(0), m_next_queue(0), m_stop(false){
+		if (threads <= 0){
+			threads = std::max(1, (int)std::thread::hardware_concurrency());
+		}
+		for (int worker = 0; worker < threads; ++worker){
+			m_queues.push_back(std::unique_ptr<WorkerQueue>(new WorkerQueue()));
+		}
+		for (int worker = 0; worker < threads; ++worker){
+			m_workers.push_back(std::thread(&SessionScheduler::run, this, worker));
+		}
+	}
+
+	SessionScheduler::~SessionScheduler(){
+		wait();
+		{
+			std::lock_guard<std::mutex> lock(m_wake_mutex);
+			m_stop = true;
+		}
+		m_wake.notify_all();
+		for (size_t worker = 0; worker < m_workers.size(); ++worker){
+			m_workers[worker].join();
+		}
+	}
+
+	int SessionScheduler::add_stream(const PipelineConfig& config, FrameCallback callback){
+		std::lock_guard<std::mutex> lock(m_streams_mutex);
+		int id = (int)m_streams.size();
+		m_streams.push_back(std::unique_ptr<Stream>(new Stream(id, config, callback)));
+		return id;
+	}
+
+	int SessionScheduler::streams(){
+		std::lock_guard<std::mutex> lock(m_streams_mutex);
+		return (int)m_streams.size();
+	}
+
+	SessionScheduler::Stream* SessionScheduler::stream(int id){
+		std::lock_guard<std::mutex> lock(m_streams_mutex);
+		return m_streams[id].get();
+	}
+
+	int SessionScheduler::frame_size(int id){
+		return stream(id)->pipeline.frame_size();
+	}
+
+	StreamStats SessionScheduler::stats(int id){
+		Stream* s = stream(id);
+		std::lock_guard<std::mutex> lock(s->mutex);
+		return s->stats;
+	}
+
+	void SessionScheduler::submit(int id, const float* input){
+		Stream* s = stream(id);
+		const size_t samples = (size_t)MAX_MICROPHONES * s->pipeline.frame_size();
+		++m_pending;
+		bool idle = false;
+		{
+			std::lock_guard<std::mutex> lock(s->mutex);
+			Frame frame;
+			if (!s->free_samples.empty()){
+				frame.samples.swap(s->free_samples.back());
+				s->free_samples.pop_back();
+			}
+			frame.samples.assign(input, input + samples);
+			frame.submitted = Clock::now();
+			s->frames.push_back(std::move(frame));
+			if (!s->scheduled){
+				s->scheduled = true;
+				idle = true;
+			}
+		}
+		// a stream that is already scheduled picks the frame up when its worker gets to it.
+		if (idle){
+			schedule(s);
+		}
+	}
+
+	void SessionScheduler::wait(){
+		std::unique_lock<std::mutex> lock(m_wake_mutex);
+		m_idle.wait(lock, [this]{ return m_pending.load() == 0; });
+	}
+
+	void SessionScheduler::schedule(Stream* s){
+		int queue = (t_scheduler == this) ? t_worker : (int)(m_next_queue++ % m_queues.size());
+		{
+			std::lock_guard<std::mutex> lock(m_queues[queue]->mutex);
+			m_queues[queue]->streams.push_back(s);
+		}
+		{
+			std::lock_guard<std::mutex> lock(m_wake_mutex);
+			++m_queued;
+		}
+		m_wake.notify_one();
+	}
+
+	SessionScheduler::Stream* SessionScheduler::next_stream(int worker){
+		const int queues = (int)m_queues.size();
+		for (int k = 0; k < queues; ++k){
+			WorkerQueue& queue = *m_queues[(worker + k) % queues];
+			std::lock_guard<std::mutex> lock(queue.mutex);
+			if (queue.streams.empty()){
+				continue;
+			}
+			// the own queue is served oldest first, which bounds the delay of its streams.
+			// thieves take the newest entry, which the owner would reach last.
+			Stream* s;
+			if (k == 0){
+				s = queue.streams.front();
+				queue.streams.pop_front();
+			}
+			else{
+				s = queue.streams.back();
+				queue.streams.pop_back();
+			}
+			--m_queued;
+			return s;
+		}
+		return NULL;
+	}
+
+	void SessionScheduler::run(int worker){
+		t_scheduler = this;
+		t_worker = worker;
+		while (true){
+			Stream* s = next_stream(worker);
+			if (s != NULL){
+				process(s);
+				continue;
+			}
+			std::unique_lock<std::mutex> lock(m_wake_mutex);
+			m_wake.wait(lock, [this]{ return m_stop || m_queued.load() > 0; });
+			if (m_stop && m_queued.load() <= 0){
+				return;
+			}
+		}
+	}
+
+	// process the oldest frame of the stream. only one worker holds the stream, so no lock is needed
+	// around the pipeline. if more frames are waiting the stream goes to the back of this worker's queue,
+	// which lets the other streams of the queue run in between.
+	void SessionScheduler::process(Stream* s){
+		Frame frame;
+		{
+			std::lock_guard<std::mutex> lock(s->mutex);
+			frame = std::move(s->frames.front());
+			s->frames.pop_front();
+		}
+		double delay = std::chrono::duration<double>(Clock::now() - frame.submitted).count();
+		s->pipeline.process(&frame.samples[0], &s->output[0]);
+		if (s->callback){
+			s->callback(s->id, &s->output[0]);
+		}
+		bool more;
+		{
+			std::lock_guard<std::mutex> lock(s->mutex);
+			StreamStats& stats = s->stats;
+			++stats.frames;
+			stats.mean_delay += (delay - stats.mean_delay) / stats.frames;
+			stats.max_delay = std::max(stats.max_delay, delay);
+			stats.last_delay = delay;
+			s->free_samples.push_back(std::move(frame.samples));
+			more = !s->frames.empty();
+			if (!more){
+				s->scheduled = false;
+			}
+		}
+		if (more){
+			schedule(s);
+		}
+		if (--m_pending == 0){
+			std::lock_guard<std::mutex> lock(m_wake_mutex);
+			m_idle.notify_all();
+		}
+	}
+}
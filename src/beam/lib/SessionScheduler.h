@@ -0,0 +1,93 @@
+#ifndef SESSIONSCHEDULER_H_
+#define SESSIONSCHEDULER_H_
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "Pipeline.h"
+
+namespace Beam{
+	/// queueing statistics of one stream. the delay of a frame is the time from submit to the start of its processing.
+	struct StreamStats{
+		StreamStats() : frames(0), mean_delay(0.0), max_delay(0.0), last_delay(0.0){}
+		long long frames; // processed frames.
+		double mean_delay; // seconds.
+		double max_delay; // seconds.
+		double last_delay; // seconds.
+	};
+
+	/// runs the pipelines of many streams on a fixed pool of threads.
+	/// every worker has a queue of streams that have frames waiting. a worker takes the oldest stream of its own queue
+	/// and steals from the other queues when its own is empty. a stream is in at most one queue at a time,
+	/// so its frames are processed one after the other, in the order they were submitted, on whichever worker is free.
+	class SessionScheduler{
+	public:
+		/// called on a worker thread with the frame_size output samples of each frame, in the order of the frames.
+		typedef std::function<void(int stream, const float* output)> FrameCallback;
+		/// threads <= 0 uses one worker per hardware thread.
+		explicit SessionScheduler(int threads = 0);
+		/// processes the frames already submitted, then stops the workers.
+		~SessionScheduler();
+		/// add a stream with its own pipeline. returns the id of the stream, 0, 1, 2 ...
+		int add_stream(const PipelineConfig& config, FrameCallback callback);
+		/// queue one frame of the stream: MAX_MICROPHONES channels of frame_size samples, channel after channel.
+		/// the input is copied, so the caller can reuse it when submit returns.
+		void submit(int stream, const float* input);
+		/// block until all submitted frames are processed.
+		void wait();
+		/// number of worker threads.
+		int threads() const { return (int)m_workers.size(); }
+		int streams();
+		/// frame size of the stream's pipeline.
+		int frame_size(int stream);
+		StreamStats stats(int stream);
+	private:
+		typedef std::chrono::steady_clock Clock;
+		struct Frame{
+			std::vector<float> samples;
+			Clock::time_point submitted;
+		};
+		struct Stream{
+			Stream(int id, const PipelineConfig& config, FrameCallback callback);
+			int id;
+			Pipeline pipeline;
+			FrameCallback callback;
+			std::vector<float> output;
+			std::mutex mutex; // guards the members below.
+			std::deque<Frame> frames;
+			std::vector<std::vector<float> > free_samples; // buffers of processed frames, reused by submit.
+			bool scheduled; // true while the stream is in a worker queue or being processed.
+			StreamStats stats;
+		};
+		struct WorkerQueue{
+			std::mutex mutex;
+			std::deque<Stream*> streams;
+		};
+		SessionScheduler(const SessionScheduler&);
+		SessionScheduler& operator=(const SessionScheduler&);
+		Stream* stream(int id);
+		void schedule(Stream* stream);
+		Stream* next_stream(int worker);
+		void run(int worker);
+		void process(Stream* stream);
+		std::vector<std::unique_ptr<WorkerQueue> > m_queues;
+		std::vector<std::thread> m_workers;
+		std::mutex m_streams_mutex;
+		std::vector<std::unique_ptr<Stream> > m_streams;
+		std::mutex m_wake_mutex; // guards the sleep of idle workers and of wait().
+		std::condition_variable m_wake;
+		std::condition_variable m_idle;
+		std::atomic<int> m_queued; // streams in the worker queues.
+		std::atomic<long long> m_pending; // submitted frames that are not processed yet.
+		std::atomic<unsigned int> m_next_queue; // queue of the next stream scheduled by a thread outside the pool.
+		bool m_stop;
+	};
+}
+
+#endif /* SESSIONSCHEDULER_H_ */
@@ -4,6 +4,8 @@
 
 namespace Beam{
 	SoundSourceLocalizer::SoundSourceLocalizer(){
+		m_first_sample = 0;
+		m_num_samples = 0;
 		m_new_sample = false;
 		m_last_time = 0.0;
 		float step = (float)TWO_PI / NUM_CLUSTERS;
@@ -20,10 +22,6 @@ namespace Beam{
 		m_num = 0;
 	}
 
-	SoundSourceLocalizer::~SoundSourceLocalizer(){
-
-	}
-
 	void SoundSourceLocalizer::init(float sample_rate, int frame_size){
 		m_sample_rate = sample_rate;
 		m_frame_size = frame_size;
@@ -113,9 +111,7 @@ namespace Beam{
 			*p_angle = m_angle[max_index];
 		}
 		else{
-			std::vector<float> x = { m_angle[max_index - 1], m_angle[max_index], m_angle[max_index + 1] };
-			std::vector<float> y = { ssl_sum[max_index - 1], ssl_sum[max_index], ssl_sum[max_index + 1] };
-			*p_angle = Utils::interpolate_max(x, y);
+			*p_angle = Utils::interpolate_max(&m_angle[max_index - 1], &ssl_sum[max_index - 1]);
 		}
 		*p_weight = weight_max / m_meas_bins / NUM_ANGLES;
 	}
@@ -124,10 +120,13 @@ namespace Beam{
 		// add next point to the measurements queue
 		// TODO check the limits.
 		//Utils::limit(weight, 0.f, 5.f);
-		m_coord_samples.push_back(CoordsSample{ time, next_point, weight });
-		if (m_coord_samples.size() > MAX_COORD_SAMPLES){
-			m_coord_samples.pop_front();
+		// the oldest sample makes room when the ring is full.
+		if (m_num_samples == MAX_COORD_SAMPLES){
+			m_first_sample = (m_first_sample + 1) % MAX_COORD_SAMPLES;
+			--m_num_samples;
 		}
+		m_coord_samples[(m_first_sample + m_num_samples) % MAX_COORD_SAMPLES] = CoordsSample{ time, next_point, weight };
+		++m_num_samples;
 		m_new_sample = true;
 	}
 
@@ -151,15 +150,15 @@ namespace Beam{
 		//  cleanup the measurements array - remove meassurements older than m_life_time
 		double last_valid_time = time - SSL_MEASUREMENT_LIFETIME;
 		//  find the begin of the valid measurement.
-		auto valid_iter = m_coord_samples.begin();
-		for (; valid_iter != m_coord_samples.end(); ++valid_iter){
-			if (valid_iter->time >= last_valid_time) break;
+		int valid = 0;
+		for (; valid < m_num_samples; ++valid){
+			if (coord_sample(valid).time >= last_valid_time) break;
 		}
-		if (m_coord_samples.empty() || valid_iter == m_coord_samples.end()){
+		if (valid == m_num_samples){
 			// queue is empty
 			return;
 		}
-		double last_measurement_time = m_coord_samples.back().time;
+		double last_measurement_time = coord_sample(m_num_samples - 1).time;
 		//  prepare the clustering
 		for (int i = 0; i < NUM_CLUSTERS; ++i){
 			m_sample_cluster[i].average = 0.f;
@@ -168,13 +167,13 @@ namespace Beam{
 			m_sample_cluster[i].num_points = 0;
 		}
 		//  cluster the measurements - horizontal plane only
-		for (auto iter = valid_iter; iter != m_coord_samples.end(); ++iter){
-			float angle = iter->point;
+		for (int sample = valid; sample < m_num_samples; ++sample){
+			float angle = coord_sample(sample).point;
 			for (int i = 0; i < NUM_CLUSTERS; ++i){
 				if (angle < m_upper_boundary[i] && angle >= m_lower_boundary[i]){
 					int index = m_sample_cluster[i].num_points;
 					m_sample_cluster[i].points[index] = angle;
-					m_sample_cluster[i].weights[index] = iter->weight;
+					m_sample_cluster[i].weights[index] = coord_sample(sample).weight;
 					++m_sample_cluster[i].num_points;
 				}
 			}
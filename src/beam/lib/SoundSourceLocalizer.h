@@ -2,7 +2,6 @@
 #define SOUNDSOURCELOCALIZER_H_
 
 #include <algorithm>
-#include <list>
 #include <memory>
 #include "KinectConfig.h"
 #include "DSPFilter.h"
@@ -25,7 +24,6 @@ namespace Beam{
 	class SoundSourceLocalizer {
 	public:
 		SoundSourceLocalizer();
-		~SoundSourceLocalizer();
 		void init(float sample_rate, int frame_size);
 		void process(std::vector<std::complex<float> >* input, std::vector<std::complex<float> >* input_, float* p_angle, float* p_weight);
 		void process_next_sample(double time, float next_point, float weight);
@@ -56,8 +54,11 @@ namespace Beam{
 		// common.
 		float m_sample_rate;
 		int m_frame_size;
-		// record samples
-		std::list<Beam::SoundSourceLocalizer::CoordsSample> m_coord_samples;
+		// record samples, a ring of the last MAX_COORD_SAMPLES from m_first_sample on.
+		const CoordsSample& coord_sample(int index) const { return m_coord_samples[(m_first_sample + index) % MAX_COORD_SAMPLES]; }
+		CoordsSample m_coord_samples[MAX_COORD_SAMPLES];
+		int m_first_sample;
+		int m_num_samples;
 		bool m_new_sample;
 		double m_last_time; // last time the angle is known.
 		Beam::SoundSourceLocalizer::Cluster m_sample_cluster[NUM_CLUSTERS];
@@ -0,0 +1,52 @@
+#ifndef SPSCQUEUE_H_
+#define SPSCQUEUE_H_
+
+#include <atomic>
+#include <vector>
+
+namespace Beam{
+	/// lock-free queue of fixed capacity between one producer thread and one consumer thread.
+	template<typename T>
+	class SpscQueue{
+	public:
+		/// the capacity is rounded up to a power of 2.
+		explicit SpscQueue(int capacity) : m_head(0), m_tail(0){
+			size_t size = 1;
+			while (size < (size_t)capacity){
+				size <<= 1;
+			}
+			m_items.resize(size);
+			m_mask = size - 1;
+		}
+		/// producer only. false if the queue is full.
+		bool push(const T& item){
+			size_t tail = m_tail.load(std::memory_order_relaxed);
+			if (tail - m_head.load(std::memory_order_acquire) > m_mask){
+				return false;
+			}
+			m_items[tail & m_mask] = item;
+			m_tail.store(tail + 1, std::memory_order_release);
+			return true;
+		}
+		/// consumer only. false if the queue is empty.
+		bool pop(T& item){
+			size_t head = m_head.load(std::memory_order_relaxed);
+			if (head == m_tail.load(std::memory_order_acquire)){
+				return false;
+			}
+			item = m_items[head & m_mask];
+			m_head.store(head + 1, std::memory_order_release);
+			return true;
+		}
+	private:
+		SpscQueue(const SpscQueue&);
+		SpscQueue& operator=(const SpscQueue&);
+		std::vector<T> m_items;
+		size_t m_mask;
+		// the producer writes m_tail, the consumer m_head. they sit on different cache lines.
+		alignas(64) std::atomic<size_t> m_head;
+		alignas(64) std::atomic<size_t> m_tail;
+	};
+}
+
+#endif /* SPSCQUEUE_H_ */
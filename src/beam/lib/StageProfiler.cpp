@@ -0,0 +1,167 @@
+#include "StageProfiler.h"
+#include <algorithm>
+#include <chrono>
+#include <thread>
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#define BEAM_X86_TSC
+#ifdef _MSC_VER
+#include <intrin.h>
+#else
+#include <x86intrin.h>
+#endif
+#endif
+
+namespace Beam{
+	static long long steady_ns(){
+		return (long long)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+	}
+
+	StageProfiler::StageProfiler(bool counters) : m_use_counters(counters){
+		reset();
+		m_start_ticks = ticks();
+		m_start_time = steady_ns();
+	}
+
+	long long StageProfiler::ticks(){
+#ifdef BEAM_X86_TSC
+		return (long long)__rdtsc();
+#else
+		return steady_ns();
+#endif
+	}
+
+	ProfileMark StageProfiler::mark(){
+		ProfileMark mark;
+		if (m_use_counters){
+			if (!m_counters){
+				m_counters.reset(new PerfCounters());
+			}
+			m_counters->read(mark.counters);
+		}
+		else{
+			std::fill(mark.counters, mark.counters + PERF_COUNTERS, 0LL);
+		}
+		mark.ticks = ticks();
+		return mark;
+	}
+
+	ProfileMark StageProfiler::record(ProfileStage stage, const ProfileMark& start){
+		ProfileMark now = mark();
+		long long elapsed = std::max(0LL, now.ticks - start.ticks);
+		++m_histograms[stage][bucket(elapsed)];
+		++m_count[stage];
+		m_total[stage] += elapsed;
+		m_max[stage] = std::max(m_max[stage], elapsed);
+		for (int counter = 0; counter < PERF_COUNTERS; ++counter){
+			m_events[stage][counter] += now.counters[counter] - start.counters[counter];
+		}
+		return now;
+	}
+
+	void StageProfiler::reset(){
+		for (int stage = 0; stage < PROFILE_ENTRIES; ++stage){
+			m_histograms[stage].assign(PROFILE_BUCKETS, 0);
+			m_count[stage] = 0;
+			m_total[stage] = 0;
+			m_max[stage] = 0;
+			std::fill(m_events[stage], m_events[stage] + PERF_COUNTERS, 0LL);
+		}
+	}
+
+	// below PROFILE_SUB_BUCKETS every tick has its bucket. above, the octave [2^e, 2^(e+1)) is split into
+	// PROFILE_SUB_BUCKETS buckets by the bits after the leading one.
+	int StageProfiler::bucket(long long ticks){
+		if (ticks < PROFILE_SUB_BUCKETS){
+			return (int)ticks;
+		}
+		int exponent = 0;
+		while ((ticks >> (exponent + 1)) != 0){
+			++exponent;
+		}
+		int sub = (int)(ticks >> (exponent - 3)) - PROFILE_SUB_BUCKETS;
+		return PROFILE_SUB_BUCKETS * (exponent - 2) + sub;
+	}
+
+	long long StageProfiler::bucket_limit(int bucket){
+		if (bucket < PROFILE_SUB_BUCKETS){
+			return bucket;
+		}
+		int exponent = bucket / PROFILE_SUB_BUCKETS + 2;
+		int sub = bucket % PROFILE_SUB_BUCKETS;
+		return ((long long)(PROFILE_SUB_BUCKETS + sub + 1) << (exponent - 3)) - 1;
+	}
+
+	long long StageProfiler::percentile(ProfileStage stage, double fraction) const{
+		long long rank = std::max(1LL, (long long)(fraction * m_count[stage] + 0.999999));
+		long long count = 0;
+		for (int b = 0; b < PROFILE_BUCKETS; ++b){
+			count += m_histograms[stage][b];
+			if (count >= rank){
+				return std::min(bucket_limit(b), m_max[stage]);
+			}
+		}
+		return m_max[stage];
+	}
+
+	double StageProfiler::tick_rate() const{
+#ifdef BEAM_X86_TSC
+		// measure over at least 10 ms, so the readings of the two clocks are far apart compared to their resolution.
+		long long elapsed = steady_ns() - m_start_time;
+		if (elapsed < 10000000){
+			std::this_thread::sleep_for(std::chrono::nanoseconds(10000000 - elapsed));
+		}
+		long long tsc = ticks();
+		elapsed = steady_ns() - m_start_time;
+		return (double)(tsc - m_start_ticks) * 1e9 / (double)elapsed;
+#else
+		return 1e9;
+#endif
+	}
+
+	StageTimes StageProfiler::times(ProfileStage stage) const{
+		StageTimes times;
+		times.count = m_count[stage];
+		if (times.count == 0){
+			return times;
+		}
+		double seconds = 1.0 / tick_rate();
+		times.p50 = percentile(stage, 0.5) * seconds;
+		times.p99 = percentile(stage, 0.99) * seconds;
+		times.max = m_max[stage] * seconds;
+		times.mean = (double)m_total[stage] / times.count * seconds;
+		for (int counter = 0; counter < PERF_COUNTERS; ++counter){
+			times.events[counter] = (double)m_events[stage][counter] / times.count;
+		}
+		return times;
+	}
+
+	const char* StageProfiler::name(ProfileStage stage){
+		switch (stage){
+		case PROFILE_ANALYSIS:
+			return "analysis";
+		case PROFILE_PREPROCESS:
+			return "preprocess";
+		case PROFILE_LOCALIZATION:
+			return "localization";
+		case PROFILE_BEAMFORMING:
+			return "beamforming";
+		case PROFILE_NOISE_SUPPRESSION:
+			return "noise suppression";
+		case PROFILE_SYNTHESIS:
+			return "synthesis";
+		case PROFILE_GAIN_CONTROL:
+			return "gain control";
+		case PROFILE_MCLT:
+			return "mclt";
+		case PROFILE_SSL:
+			return "ssl";
+		case PROFILE_VAD:
+			return "vad";
+		case PROFILE_FIXED_BEAMS:
+			return "fixed beams";
+		default:
+			return "unknown";
+		}
+	}
+}
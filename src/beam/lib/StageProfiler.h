@@ -0,0 +1,94 @@
+#ifndef STAGEPROFILER_H_
+#define STAGEPROFILER_H_
+
+#include <memory>
+#include <vector>
+#include "PerfCounters.h"
+
+namespace Beam{
+// the histograms have 8 buckets per octave of ticks, so a percentile is at most 12.5% above the true value.
+#define PROFILE_SUB_BUCKETS 8
+#define PROFILE_BUCKETS (PROFILE_SUB_BUCKETS * 62)
+
+	/// the timed steps of a pipeline, in the order of Pipeline::process.
+	enum ProfileStage{
+		PROFILE_ANALYSIS = 0, // MCLT of all channels.
+		PROFILE_PREPROCESS, // pre noise suppression, calibration gains and phase compensation.
+		PROFILE_LOCALIZATION, // sound source localization and calibration.
+		PROFILE_BEAMFORMING, // dereverberation and beamforming.
+		PROFILE_NOISE_SUPPRESSION, // noise suppression of the beamformer output.
+		PROFILE_SYNTHESIS, // inverse MCLT.
+		PROFILE_GAIN_CONTROL,
+		PROFILE_STAGES,
+		// kernels inside the stages. they are only timed when they run, e.g. MsrVAD with NOISE_SUPPRESSOR_MSR.
+		PROFILE_MCLT = PROFILE_STAGES, // MCLT::AecCcsFwdMcltBatch of the analysis.
+		PROFILE_SSL, // SoundSourceLocalizer::process.
+		PROFILE_VAD, // MsrVAD::process.
+		PROFILE_FIXED_BEAMS, // Beamformer::compute.
+		PROFILE_ENTRIES
+	};
+
+	/// a reading of the clock and of the counters, the start or the end of a stage.
+	struct ProfileMark{
+		long long ticks;
+		long long counters[PERF_COUNTERS];
+	};
+
+	/// times of one stage in seconds. the percentiles are the upper bounds of their histogram buckets.
+	struct StageTimes{
+		StageTimes() : count(0), p50(0.0), p99(0.0), max(0.0), mean(0.0){
+			for (int counter = 0; counter < PERF_COUNTERS; ++counter){
+				events[counter] = 0.0;
+			}
+		}
+		long long count;
+		double p50;
+		double p99;
+		double max;
+		double mean;
+		double events[PERF_COUNTERS]; // mean count per call of the PerfCounters, 0 without counters.
+	};
+
+	/// histograms of the time every stage of a pipeline takes, see PipelineConfig::profile.
+	/// the clock is the time stamp counter on x86, which costs a few ns per reading,
+	/// and std::chrono::steady_clock elsewhere. the rate of the counter is measured against the steady clock
+	/// between the construction and the call of times(), so it does not depend on a fixed cpu frequency.
+	/// every stage has its own histogram, so the stages of a StagedPipeline can record on their own threads.
+	/// with counters, every mark also reads the PerfCounters, a system call of about a microsecond.
+	/// they are opened by the first mark and count the thread that made it, so they are only right
+	/// for pipelines that run on one thread.
+	class StageProfiler{
+	public:
+		explicit StageProfiler(bool counters = false);
+		/// the current reading of the clock.
+		static long long ticks();
+		/// the current reading of the clock and the counters.
+		ProfileMark mark();
+		/// record the time and the events from start to now for stage and return now, the start of the next stage.
+		ProfileMark record(ProfileStage stage, const ProfileMark& start);
+		/// clear the histograms.
+		void reset();
+		StageTimes times(ProfileStage stage) const;
+		/// true if counters were requested and at least one of them counts.
+		bool counters_available() const { return m_counters && m_counters->available(); }
+		bool counter_available(PerfCounter counter) const { return m_counters && m_counters->available(counter); }
+		/// clock ticks per second.
+		double tick_rate() const;
+		static const char* name(ProfileStage stage);
+	private:
+		static int bucket(long long ticks);
+		static long long bucket_limit(int bucket);
+		long long percentile(ProfileStage stage, double fraction) const;
+		std::vector<long long> m_histograms[PROFILE_ENTRIES];
+		long long m_count[PROFILE_ENTRIES];
+		long long m_total[PROFILE_ENTRIES];
+		long long m_max[PROFILE_ENTRIES];
+		long long m_events[PROFILE_ENTRIES][PERF_COUNTERS];
+		bool m_use_counters;
+		std::unique_ptr<PerfCounters> m_counters;
+		long long m_start_ticks;
+		long long m_start_time; // ns of the steady clock.
+	};
+}
+
+#endif /* STAGEPROFILER_H_ */
@@ -0,0 +1,113 @@
+#include "StagedPipeline.h"
+#include <algorithm>
+#include <chrono>
+
+namespace Beam{
+	// waiting for a queue: spin for a while, which keeps the latency low when the stages are busy,
+	// then sleep, which keeps idle stages off the cpu.
+	static void wait_for_queue(int& spins){
+		if (++spins < 1000){
+			std::this_thread::yield();
+		}
+		else{
+			std::this_thread::sleep_for(std::chrono::microseconds(100));
+		}
+	}
+
+	StagedPipeline::Slot::Slot(int frame_size) : gain(1.f), frame(frame_size){
+		input.assign(MAX_MICROPHONES * frame_size, 0.f);
+		output.assign(frame_size, 0.f);
+	}
+
+	// the staged pipeline has one output, so it does not compute the beams of PipelineConfig::beams.
+	static PipelineConfig single_output(PipelineConfig config){
+		config.beams = 0;
+		return config;
+	}
+
+	StagedPipeline::StagedPipeline(const PipelineConfig& config, int latency) : m_pipeline(single_output(config)){
+		m_frame_size = m_pipeline.frame_size();
+		m_latency = std::max(0, latency);
+		m_in_flight = 0;
+		m_gain = m_pipeline.gain();
+		// a frame is queued before the output latency frames back is taken, so latency + 1 frames are in flight.
+		for (int slot = 0; slot <= m_latency; ++slot){
+			m_slots.push_back(Slot(m_frame_size));
+			m_free_slots.push_back(slot);
+		}
+		// room for all slots and the stop marker.
+		for (int stage = 0; stage <= PIPELINE_STAGES; ++stage){
+			m_queues[stage].reset(new SpscQueue<int>(m_latency + 2));
+		}
+		for (int stage = 0; stage < PIPELINE_STAGES; ++stage){
+			m_threads.push_back(std::thread(&StagedPipeline::run, this, stage));
+		}
+	}
+
+	StagedPipeline::~StagedPipeline(){
+		// the stop marker passes every stage after the frames in front of it.
+		m_queues[0]->push(-1);
+		for (size_t stage = 0; stage < m_threads.size(); ++stage){
+			m_threads[stage].join();
+		}
+	}
+
+	void StagedPipeline::process(const float* input, float* output){
+		int index = m_free_slots.back();
+		m_free_slots.pop_back();
+		Slot& slot = m_slots[index];
+		std::copy(input, input + slot.input.size(), slot.input.begin());
+		slot.gain = m_gain;
+		m_queues[0]->push(index);
+		++m_in_flight;
+		if (m_in_flight <= m_latency){
+			std::fill(output, output + m_frame_size, 0.f);
+			return;
+		}
+		int spins = 0;
+		while (!m_queues[PIPELINE_STAGES]->pop(index)){
+			wait_for_queue(spins);
+		}
+		std::copy(m_slots[index].output.begin(), m_slots[index].output.end(), output);
+		m_gain = m_slots[index].gain;
+		m_free_slots.push_back(index);
+		--m_in_flight;
+	}
+
+	// every stage works on its own part of the pipeline, see Pipeline::analyze.
+	// the queues hand the slots from one stage to the next, so a slot is only touched by one thread at a time.
+	void StagedPipeline::run(int stage){
+		SpscQueue<int>& input = *m_queues[stage];
+		SpscQueue<int>& output = *m_queues[stage + 1];
+		while (true){
+			int index;
+			int spins = 0;
+			while (!input.pop(index)){
+				wait_for_queue(spins);
+			}
+			if (index >= 0){
+				Slot& slot = m_slots[index];
+				switch (stage){
+				case 0:
+					m_pipeline.analyze(&slot.input[0], slot.gain, slot.frame);
+					break;
+				case 1:
+					m_pipeline.localize(slot.frame);
+					break;
+				case 2:
+					m_pipeline.beamform(slot.frame);
+					break;
+				default:
+					m_pipeline.synthesize(slot.frame, &slot.output[0]);
+					slot.gain = m_pipeline.gain();
+					break;
+				}
+			}
+			// the queues have room for every slot and the stop marker, so the push cannot fail.
+			output.push(index);
+			if (index < 0){
+				return;
+			}
+		}
+	}
+}
@@ -0,0 +1,56 @@
+#ifndef STAGEDPIPELINE_H_
+#define STAGEDPIPELINE_H_
+
+#include <memory>
+#include <thread>
+#include <vector>
+#include "Pipeline.h"
+#include "SpscQueue.h"
+
+namespace Beam{
+// analysis, localization, beamforming and post-processing.
+#define PIPELINE_STAGES 4
+
+	/// runs the stages of one pipeline on their own threads, connected by lock-free queues of frames:
+	/// analysis (MCLT of all channels), localization, beamforming and post-processing
+	/// (noise suppression and inverse MCLT). for one stream whose pipeline does not keep up on one core.
+	/// the output lags the input by a fixed number of frames. the gain control feeds back into the input
+	/// with the same lag, so with latency 0 the output is the one of Pipeline::process, with more latency
+	/// it differs while the gain changes. it does not depend on the timing of the threads.
+	class StagedPipeline{
+	public:
+		/// latency is the number of frames an output lags its input, from 0 (the stages take turns)
+		/// to PIPELINE_STAGES - 1 (every stage busy) or more (room for jitter between the stages).
+		explicit StagedPipeline(const PipelineConfig& config = PipelineConfig(), int latency = PIPELINE_STAGES - 1);
+		/// stops the stage threads, frames still in flight are dropped.
+		~StagedPipeline();
+		int frame_size() const { return m_frame_size; }
+		int latency() const { return m_latency; }
+		/// queue one input frame, in the layout of Pipeline::process, and return the output of
+		/// the frame latency() calls before. the first latency() outputs are silence.
+		void process(const float* input, float* output);
+	private:
+		struct Slot{
+			Slot(int frame_size);
+			std::vector<float> input;
+			float gain; // input gain of the analysis, then gain after the post-processing.
+			PipelineFrame frame;
+			std::vector<float> output;
+		};
+		StagedPipeline(const StagedPipeline&);
+		StagedPipeline& operator=(const StagedPipeline&);
+		void run(int stage);
+		int m_frame_size;
+		int m_latency;
+		Pipeline m_pipeline;
+		std::vector<Slot> m_slots;
+		std::vector<int> m_free_slots; // slots the caller can fill.
+		int m_in_flight;
+		float m_gain; // gain after the newest output frame.
+		// m_queues[stage] feeds the stage, m_queues[PIPELINE_STAGES] returns the frames to the caller.
+		std::unique_ptr<SpscQueue<int> > m_queues[PIPELINE_STAGES + 1];
+		std::vector<std::thread> m_threads;
+	};
+}
+
+#endif /* STAGEDPIPELINE_H_ */
@@ -0,0 +1,75 @@
+#include "SteeringVectors.h"
+#include <cmath>
+#include <cstdlib>
+#include <map>
+#include <mutex>
+#include <new>
+#include <thread>
+
+namespace Beam{
+	const SteeringVectors& SteeringVectors::get(int frame_size){
+		static std::mutex mutex;
+		static std::map<int, std::unique_ptr<SteeringVectors> > caches;
+		std::lock_guard<std::mutex> lock(mutex);
+		std::unique_ptr<SteeringVectors>& cache = caches[frame_size];
+		if (!cache){
+			cache.reset(new SteeringVectors(frame_size));
+		}
+		return *cache;
+	}
+
+	SteeringVectors::SteeringVectors(int frame_size) : m_frame_size(frame_size), m_state(new std::atomic<int>[STEERING_ANGLES]){
+		for (int index = 0; index < STEERING_ANGLES; ++index){
+			m_state[index].store(0);
+		}
+		// malloc leaves the pages alone until an angle is filled, unlike the value-initialized new[].
+		m_vectors = static_cast<std::complex<float>*>(malloc((size_t)STEERING_ANGLES * frame_size * MAX_MICROPHONES * sizeof(std::complex<float>)));
+		if (!m_vectors){
+			throw std::bad_alloc();
+		}
+	}
+
+	SteeringVectors::~SteeringVectors(){
+		free(m_vectors);
+	}
+
+	int SteeringVectors::quantize(float angle){
+		int index = (int)lround(angle * (STEERING_ANGLES / TWO_PI)) % STEERING_ANGLES;
+		return index < 0 ? index + STEERING_ANGLES : index;
+	}
+
+	const std::complex<float>* SteeringVectors::vector(float angle) const{
+		int index = quantize(angle);
+		if (m_state[index].load(std::memory_order_acquire) != 2){
+			int empty = 0;
+			if (m_state[index].compare_exchange_strong(empty, 1, std::memory_order_acq_rel)){
+				fill(index);
+				m_state[index].store(2, std::memory_order_release);
+			}
+			else{
+				// another thread computes the angle, which takes a few microseconds.
+				while (m_state[index].load(std::memory_order_acquire) != 2){
+					std::this_thread::yield();
+				}
+			}
+		}
+		return m_vectors + (size_t)index * m_frame_size * MAX_MICROPHONES;
+	}
+
+	void SteeringVectors::fill(int index) const{
+		const double angle = index * TWO_PI / STEERING_ANGLES;
+		float time_delay[MAX_MICROPHONES] = { 0.f };
+		for (int channel = 0; channel < MAX_MICROPHONES; ++channel){
+			float distance = KinectConfig::kinect_descriptor.mic[channel].y * sinf((float)angle);
+			time_delay[channel] = distance / (float)SOUND_SPEED;
+		}
+		std::complex<float>* vector = m_vectors + (size_t)index * m_frame_size * MAX_MICROPHONES;
+		for (int bin = 0; bin < m_frame_size; ++bin){
+			float rad_freq = (float)(-bin * TWO_PI * SAMPLE_RATE / m_frame_size / 2.f);
+			for (int channel = 0; channel < MAX_MICROPHONES; ++channel){
+				float v = rad_freq * time_delay[channel];
+				new (&vector[bin * MAX_MICROPHONES + channel]) std::complex<float>(cosf(v), sinf(v));
+			}
+		}
+	}
+}
@@ -0,0 +1,43 @@
+#ifndef STEERINGVECTORS_H_
+#define STEERINGVECTORS_H_
+
+#include <atomic>
+#include <complex>
+#include <memory>
+#include "GlobalConfig.h"
+#include "KinectConfig.h"
+#include "Utils.h"
+
+namespace Beam{
+// steering vectors per full turn of the sound source angle, 0.5 degrees apart.
+#define STEERING_ANGLES 720
+
+	/// cache of the steering vectors of the kinect array for one frame size: the phasors
+	/// exp(i * w * t) of every bin and microphone, with w = -pi * bin * SAMPLE_RATE / frame_size
+	/// and the delay t = y * sin(angle) / SOUND_SPEED of the microphone at y.
+	/// the angle is quantized to STEERING_ANGLES per turn. the vector of an angle is computed the first time
+	/// it is asked for and then shared read-only by every beamformer of the frame size, on any thread.
+	/// the memory of all the angles is reserved up front, but only touched for the angles in use,
+	/// so finding a vector never allocates.
+	class SteeringVectors{
+	public:
+		/// the cache of frame_size, created by the first call.
+		static const SteeringVectors& get(int frame_size);
+		~SteeringVectors();
+		int frame_size() const { return m_frame_size; }
+		/// the steering vector of angle in radians: vector[bin * MAX_MICROPHONES + channel].
+		const std::complex<float>* vector(float angle) const;
+		/// index of the quantized angle, from 0 to STEERING_ANGLES - 1.
+		static int quantize(float angle);
+	private:
+		explicit SteeringVectors(int frame_size);
+		SteeringVectors(const SteeringVectors&);
+		SteeringVectors& operator=(const SteeringVectors&);
+		void fill(int index) const;
+		int m_frame_size;
+		std::unique_ptr<std::atomic<int>[]> m_state; // per angle: 0 empty, 1 being computed, 2 ready.
+		std::complex<float>* m_vectors; // [angle][bin][channel], raw memory from malloc.
+	};
+}
+
+#endif /* STEERINGVECTORS_H_ */
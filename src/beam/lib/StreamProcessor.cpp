@@ -0,0 +1,86 @@
+#include "StreamProcessor.h"
+#include <algorithm>
+#include <climits>
+
+namespace Beam{
+	StreamProcessor::StreamProcessor(const PipelineConfig& config, int channels, SampleFormat format) : m_pipeline(config),
+		m_channels(std::max(1, channels)), m_format(format), m_filled(0), m_read(0), m_write(0){
+		const int frame_size = m_pipeline.frame_size();
+		m_frame.assign(MAX_MICROPHONES * frame_size, 0.f);
+		m_frame_output.assign(frame_size, 0.f);
+		size_t size = 1;
+		while (size < (size_t)(2 * frame_size)){
+			size <<= 1;
+		}
+		m_ring.assign(size, 0.f);
+	}
+
+	void StreamProcessor::push(const void* pcm, int samples){
+		switch (m_format){
+		case SAMPLE_FORMAT_S32:
+			deinterleave((const int*)pcm, samples, 1.f / INT_MAX);
+			break;
+		case SAMPLE_FORMAT_F32:
+			deinterleave((const float*)pcm, samples, 1.f);
+			break;
+		default:
+			deinterleave((const short*)pcm, samples, 1.f / SHRT_MAX);
+			break;
+		}
+	}
+
+	// fills the frame up to the end of the chunk or of the frame, whichever comes first,
+	// converting every sample as it is read.
+	template<typename T>
+	void StreamProcessor::deinterleave(const T* pcm, int samples, float scale){
+		const int frame_size = m_pipeline.frame_size();
+		const int channels = std::min(m_channels, MAX_MICROPHONES);
+		while (samples > 0){
+			int count = std::min(samples, frame_size - m_filled);
+			for (int channel = 0; channel < channels; ++channel){
+				const T* in = pcm + channel;
+				float* out = &m_frame[channel * frame_size + m_filled];
+				for (int i = 0; i < count; ++i){
+					out[i] = (float)in[i * m_channels] * scale;
+				}
+			}
+			pcm += count * m_channels;
+			samples -= count;
+			m_filled += count;
+			if (m_filled == frame_size){
+				m_pipeline.process(&m_frame[0], &m_frame_output[0]);
+				write_output(&m_frame_output[0], frame_size);
+				m_filled = 0;
+			}
+		}
+	}
+
+	void StreamProcessor::write_output(const float* samples, int count){
+		if (m_write - m_read + count > m_ring.size()){
+			size_t size = m_ring.size();
+			while (m_write - m_read + count > size){
+				size <<= 1;
+			}
+			std::vector<float> ring(size);
+			for (size_t i = m_read; i < m_write; ++i){
+				ring[i & (size - 1)] = m_ring[i & (m_ring.size() - 1)];
+			}
+			m_ring.swap(ring);
+		}
+		const size_t mask = m_ring.size() - 1;
+		for (int i = 0; i < count; ++i){
+			m_ring[(m_write + i) & mask] = samples[i];
+		}
+		m_write += count;
+	}
+
+	int StreamProcessor::pull(float* output, int max_samples){
+		int count = std::max(0, std::min(max_samples, available()));
+		const size_t mask = m_ring.size() - 1;
+		for (int i = 0; i < count; ++i){
+			output[i] = m_ring[(m_read + i) & mask];
+		}
+		m_read += count;
+		return count;
+	}
+}
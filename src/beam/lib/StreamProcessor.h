@@ -0,0 +1,48 @@
+#ifndef STREAMPROCESSOR_H_
+#define STREAMPROCESSOR_H_
+
+#include <vector>
+#include "Pipeline.h"
+
+namespace Beam{
+	/// sample formats of the interleaved pcm pushed into a StreamProcessor.
+	enum SampleFormat{
+		SAMPLE_FORMAT_S16 = 0, // 16 bit signed, scaled by 1 / SHRT_MAX like WavReader.
+		SAMPLE_FORMAT_S32, // 32 bit signed, scaled by 1 / INT_MAX.
+		SAMPLE_FORMAT_F32 // float, taken as is.
+	};
+
+	/// streaming front end of a pipeline for chunks of any size.
+	/// push converts and de-interleaves the pcm straight into the frame the pipeline reads and runs the pipeline
+	/// whenever a frame is complete. the output goes to a ring buffer that pull reads from.
+	/// e.g. 480 sample packets with 256 sample frames give output in steps of 256 samples.
+	class StreamProcessor{
+	public:
+		/// channels is the number of interleaved channels in the pcm. the first MAX_MICROPHONES are used,
+		/// missing ones are silent.
+		StreamProcessor(const PipelineConfig& config = PipelineConfig(), int channels = MAX_MICROPHONES, SampleFormat format = SAMPLE_FORMAT_S16);
+		int frame_size() const { return m_pipeline.frame_size(); }
+		/// add samples samples per channel. pcm holds channels * samples values in the sample format.
+		void push(const void* pcm, int samples);
+		/// copy up to max_samples output samples to output, returns the number copied.
+		int pull(float* output, int max_samples);
+		/// output samples ready to pull.
+		int available() const { return (int)(m_write - m_read); }
+	private:
+		template<typename T>
+		void deinterleave(const T* pcm, int samples, float scale);
+		void write_output(const float* samples, int count);
+		Pipeline m_pipeline;
+		int m_channels;
+		SampleFormat m_format;
+		std::vector<float> m_frame; // the frame in the layout of Pipeline::process.
+		int m_filled; // samples per channel in m_frame.
+		std::vector<float> m_frame_output;
+		// output ring buffer. its size is a power of 2, it grows if the output is not pulled in time.
+		std::vector<float> m_ring;
+		size_t m_read;
+		size_t m_write;
+	};
+}
+
+#endif /* STREAMPROCESSOR_H_ */
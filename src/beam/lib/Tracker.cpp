@@ -4,10 +4,6 @@ namespace Beam{
 	Tracker::Tracker(double tau_threshold_up, double tau_threshold_down, double level, double time) : m_tau_threshold_up(tau_threshold_up), m_tau_threshold_down(tau_threshold_down), m_level(level), m_time(time), m_signal(0){
 	}
 
-	Tracker::~Tracker(){
-
-	}
-
 	double Tracker::nextLevel(double time, double level){
 		if (level < m_level){
 			m_level += (time - m_time) / m_tau_threshold_down * (level - m_level);
@@ -5,7 +5,6 @@ namespace Beam{
 	class Tracker {
 	public:
 		Tracker(double tau_threshold_up, double tau_threshold_down, double level, double time);
-		~Tracker();
 		double nextLevel(double time, double level);
 		double getLevel();
 		void setLevel(double level);
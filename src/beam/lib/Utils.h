@@ -3,7 +3,10 @@
 
 #include <cfloat>
 #include <complex>
+#include <cstdint>
+#include <cstdlib>
 #include <memory>
+#include <new>
 #include <vector>
 #include "Coords.h"
 
@@ -12,6 +15,39 @@ namespace Beam{
 #define HALF_PI 1.5707963267948966192313216916398
 #define TWO_PI 6.283185307179586476925286766559
 #define TO_RAD 0.017453292519943295769236907684886
+// alignment of the buffers SIMD kernels load from, a cache line.
+#define SIMD_ALIGNMENT 64
+
+	/// allocator of memory aligned to SIMD_ALIGNMENT bytes.
+	template<typename T>
+	struct AlignedAllocator{
+		typedef T value_type;
+		AlignedAllocator(){}
+		template<typename U>
+		AlignedAllocator(const AlignedAllocator<U>&){}
+		T* allocate(size_t n){
+			// the pointer malloc returned is stored right in front of the aligned block.
+			void* block = malloc(n * sizeof(T) + SIMD_ALIGNMENT + sizeof(void*));
+			if (!block){
+				throw std::bad_alloc();
+			}
+			uintptr_t start = ((uintptr_t)block + sizeof(void*) + SIMD_ALIGNMENT - 1) & ~(uintptr_t)(SIMD_ALIGNMENT - 1);
+			((void**)start)[-1] = block;
+			return (T*)start;
+		}
+		void deallocate(T* p, size_t){
+			if (p){
+				free(((void**)p)[-1]);
+			}
+		}
+	};
+	template<typename T, typename U>
+	bool operator==(const AlignedAllocator<T>&, const AlignedAllocator<U>&){ return true; }
+	template<typename T, typename U>
+	bool operator!=(const AlignedAllocator<T>&, const AlignedAllocator<U>&){ return false; }
+	/// vector with its data aligned to SIMD_ALIGNMENT bytes.
+	template<typename T>
+	using AlignedVector = std::vector<T, AlignedAllocator<T> >;
 
 	class Utils {
 	public:
@@ -121,9 +157,9 @@ namespace Beam{
 				v = sqrt(v);
 			}
 		}
-		// interpolate the qualtratic function.
+		// interpolate the qualtratic function through the 3 points x[i], y[i].
 		template<typename T>
-		static T interpolate_max(const std::vector<T>& x, const std::vector<T>& y){
+		static T interpolate_max(const T* x, const T* y){
 			T dY20;
 			T dY10;
 			T dA;
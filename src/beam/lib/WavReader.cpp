@@ -1,8 +1,10 @@
 #include "WavReader.h"
+#include <algorithm>
+#include <climits>
 #include <iostream>
 
 namespace Beam{
-	WavReader::WavReader(const std::string& file){
+	WavReader::WavReader(const std::string& file) : m_data_length(0), m_data_size(0){
 		m_in_stream.open(file, std::ios::binary);
 		if (m_in_stream.good()){
 			m_in_stream.seekg(22, m_in_stream.beg);
@@ -15,6 +17,7 @@ namespace Beam{
 			m_in_stream.seekg(0, m_in_stream.end);
 			m_data_length = (long long)m_in_stream.tellg();
 			m_data_length -= 44;
+			m_data_size = m_data_length;
 			m_in_stream.seekg(44, m_in_stream.beg);
 		}
 	}
@@ -51,13 +54,13 @@ namespace Beam{
 	//	}
 	//}
 
-	void WavReader::convert_format(float input[][FRAME_SIZE], char* buf, int buf_size){
+	void WavReader::convert_format(float* input, char* buf, int buf_size){
 		if (m_bit_per_sample == 16){
 			short* ptr = (short*)(buf);
 			int len = buf_size / m_bit_per_sample * 8 / m_channels;
 			for (int channel = 0; channel < m_channels; ++channel){
 				for (int bin = 0; bin < len; ++bin){
-					input[channel][bin] = (float)(ptr[m_channels * bin + channel]) / SHRT_MAX;
+					input[channel * len + bin] = (float)(ptr[m_channels * bin + channel]) / SHRT_MAX;
 				}
 			}
 		}
@@ -68,7 +71,7 @@ namespace Beam{
 			for (int channel = 0; channel < m_channels; ++channel){
 				for (int bin = 0; bin < len; ++bin){
 					// switch channels because of different geometry.
-					input[MAX_MICROPHONES - 1 - channel][bin] = (float)ptr[m_channels * bin + channel] / INT_MAX;			
+					input[(MAX_MICROPHONES - 1 - channel) * len + bin] = (float)ptr[m_channels * bin + channel] / INT_MAX;			
 				}
 			}
 		}
@@ -82,6 +85,18 @@ namespace Beam{
 		return (int)m_bit_per_sample;
 	}
 
+	long long WavReader::get_data_size(){
+		return m_data_size;
+	}
+
+	void WavReader::seek(long long offset){
+		if (m_in_stream.good()){
+			offset = std::min(std::max(offset, 0LL), m_data_size);
+			m_in_stream.seekg(44 + offset, m_in_stream.beg);
+			m_data_length = m_data_size - offset;
+		}
+	}
+
 	int WavReader::swap_int32(int val){
 		val = ((val << 8) & 0xFF00FF00) | ((val >> 8) & 0xFF00FF);
 		return (val << 16) | ((val >> 16) & 0xFFFF);
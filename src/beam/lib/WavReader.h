@@ -14,9 +14,14 @@ namespace Beam{
 		void read(char* buf, int buf_size, int* filled_size);
 		/// convert the input buffer to appropriate format.
 		//void convert_format(std::vector<float>* input, char* buf, int buf_size);
-		void convert_format(float input[][FRAME_SIZE], char* buf, int buf_size);
+		/// input receives the frame of every channel, channel after channel.
+		void convert_format(float* input, char* buf, int buf_size);
 		int get_channels();
 		int get_bit_per_sample();
+		/// bytes of sample data in the file.
+		long long get_data_size();
+		/// continue reading at offset bytes into the sample data.
+		void seek(long long offset);
 		int swap_int32(int val);
 	private:
 		std::ifstream m_in_stream;
@@ -24,7 +29,8 @@ namespace Beam{
 		short m_channels;
 		short m_bit_per_sample;
 		int m_size;
-		long long m_data_length;
+		long long m_data_length; // bytes left to read.
+		long long m_data_size;
 	};
 }
 